@@ -8,6 +8,7 @@ export default {
   homePath: homePath,
   userPackagePath: path.join(homePath, '/packages'),
   profilePath: path.join(homePath, '/profiles'),
+  codeCachePath: path.join(homePath, '/code-cache'),
   packagePath: path.join(path.dirname(__dirname), '/../packages'),
   electronVersion: pkg.devDependencies.electron,
   version: pkg.version,
@@ -1,5 +1,6 @@
 import { EventEmitter } from 'events';
 import paperfilter from 'paperfilter';
+import Env from './env';
 
 export default class Session extends EventEmitter {
   constructor(pubsub, pkg) {
@@ -8,6 +9,8 @@ export default class Session extends EventEmitter {
     this._pkg = pkg;
     this._dissectors = [];
     this._streamDissectors = [];
+    this._nativeDissectors = [];
+    this._dissectorPlugins = [];
     this._filterHints = {};
   }
 
@@ -27,6 +30,18 @@ export default class Session extends EventEmitter {
     });
   }
 
+  registerNativeDissector(name) {
+    if (!this._nativeDissectors.includes(name)) {
+      this._nativeDissectors.push(name);
+    }
+  }
+
+  registerDissectorPlugin(path) {
+    if (!this._dissectorPlugins.includes(path)) {
+      this._dissectorPlugins.push(path);
+    }
+  }
+
   unregisterDissector(script) {
     let index = this._dissectors.find(e => e.path === script);
     if (index != null) {
@@ -41,6 +56,20 @@ export default class Session extends EventEmitter {
     }
   }
 
+  unregisterNativeDissector(name) {
+    let index = this._nativeDissectors.indexOf(name);
+    if (index >= 0) {
+      this._nativeDissectors.splice(index, 1);
+    }
+  }
+
+  unregisterDissectorPlugin(path) {
+    let index = this._dissectorPlugins.indexOf(path);
+    if (index >= 0) {
+      this._dissectorPlugins.splice(index, 1);
+    }
+  }
+
   registerFilterHints(name, hints) {
     this._filterHints[name] = hints;
     this._updateFilterHints();
@@ -69,6 +98,9 @@ export default class Session extends EventEmitter {
       namespace: '::<Ethernet>',
       dissectors: this._dissectors,
       stream_dissectors: this._streamDissectors,
+      native_dissectors: this._nativeDissectors,
+      dissector_plugins: this._dissectorPlugins,
+      code_cache: Env.codeCachePath,
       config: this._pkg.getConfigData()
     };
 
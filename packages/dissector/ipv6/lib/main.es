@@ -2,7 +2,7 @@ import { Session } from 'dripcap';
 
 export default class IPv6 {
   activate() {
-    Session.registerDissector(`${__dirname}/ipv6.es`);
+    Session.registerNativeDissector('ipv6');
     Session.registerFilterHints('ipv6', [
       {filter: 'ipv6',                description: 'IPv6'},
       {filter: 'ipv6.version',        description: 'Version'},
@@ -19,7 +19,7 @@ export default class IPv6 {
   }
 
   deactivate() {
-    Session.unregisterDissector(`${__dirname}/ipv6.es`);
+    Session.unregisterNativeDissector('ipv6');
     Session.unregisterFilterHints('ipv6');
   }
 }
@@ -2,7 +2,7 @@ import { Session } from 'dripcap';
 
 export default class TCP {
   activate() {
-    Session.registerDissector(`${__dirname}/tcp.es`);
+    Session.registerNativeDissector('tcp');
     Session.registerStreamDissector(`${__dirname}/tcp_stream.es`);
     Session.registerFilterHints('tcp', [
       {filter: 'tcp',                description: 'TCP'},
@@ -32,7 +32,7 @@ export default class TCP {
   }
 
   deactivate() {
-    Session.unregisterDissector(`${__dirname}/tcp.es`);
+    Session.unregisterNativeDissector('tcp');
     Session.unregisterStreamDissector(`${__dirname}/tcp_stream.es`);
     Session.unregisterFilterHints('tcp');
   }
@@ -1,5 +1,4 @@
 import $ from 'jquery';
-import fs from 'fs';
 import path from 'path';
 import {remote} from 'electron';
 const {MenuItem} = remote;
@@ -10,91 +9,11 @@ let pcapFiles = [];
 let selectedSession = null;
 
 for (let file of Argv._) {
-  if (file.endsWith('.pcap')) {
+  if (file.endsWith('.pcap') || file.endsWith('.pcapng')) {
     pcapFiles.push(path.resolve(file));
   }
 }
 
-class Pcap {
-  constructor(filePath) {
-    let data = fs.readFileSync(filePath);
-    if (data.length < 24) { throw new Error('too short global header'); }
-
-    let magicNumber = data.readUInt32BE(0, true);
-    switch (magicNumber) {
-      case 0xd4c3b2a1:
-        var littleEndian = true;
-        var nanosec = false;
-        break;
-      case 0xa1b2c3d4:
-        littleEndian = false;
-        nanosec = false;
-        break;
-      case 0x4d3cb2a1:
-        littleEndian = true;
-        nanosec = true;
-        break;
-      case 0xa1b23c4d:
-        littleEndian = false;
-        nanosec = true;
-        break;
-      default:
-        throw new Error('wrong magic_number');
-    }
-
-    if (littleEndian) {
-      this.versionMajor = data.readUInt16LE(4, true);
-      this.versionMinor = data.readUInt16LE(6, true);
-      this.thiszone = data.readInt16LE(8, true);
-      this.sigfigs = data.readUInt32LE(12, true);
-      this.snaplen = data.readUInt32LE(16, true);
-      this.network = data.readUInt32LE(20, true);
-    } else {
-      this.versionMajor = data.readUInt16BE(4, true);
-      this.versionMinor = data.readUInt16BE(6, true);
-      this.thiszone = data.readInt16BE(8, true);
-      this.sigfigs = data.readUInt32BE(12, true);
-      this.snaplen = data.readUInt32BE(16, true);
-      this.network = data.readUInt32BE(20, true);
-    }
-
-    this.packets = [];
-
-    let offset = 24;
-    while (offset < data.length) {
-      let tsSec = 0, tsUsec = 0, inclLen = 0, origLen = 0;
-
-      if (data.length - offset < 16) { throw new Error('too short packet header'); }
-      if (littleEndian) {
-        tsSec = data.readUInt32LE(offset, true);
-        tsUsec = data.readUInt32LE(offset + 4, true);
-        inclLen = data.readUInt32LE(offset + 8, true);
-        origLen = data.readUInt32LE(offset + 12, true);
-      } else {
-        tsSec = data.readUInt32BE(offset, true);
-        tsUsec = data.readUInt32BE(offset + 4, true);
-        inclLen = data.readUInt32BE(offset + 8, true);
-        origLen = data.readUInt32BE(offset + 12, true);
-      }
-
-      offset += 16;
-      if (data.length - offset < inclLen) { throw new Error('too short packet body'); }
-
-      let payload = data.slice(offset, offset + inclLen);
-
-      let pakcet = {
-        ts_sec: tsSec,
-        ts_nsec: nanosec ? tsUsec : tsUsec * 1000,
-        length: origLen,
-        payload: payload
-      };
-
-      this.packets.push(pakcet);
-      offset += inclLen;
-    }
-  }
-}
-
 export default class PcapFile {
   async activate() {
     for (let filePath of pcapFiles) {
@@ -122,7 +41,7 @@ export default class PcapFile {
     Menu.registerMain('File', this.fileMenu, 5);
 
     PubSub.on(this, 'pcap-file:open', () => {
-      let filePath = dialog.showOpenDialog(remote.getCurrentWindow(), {filters: [{name: 'PCAP File', extensions: ['pcap']}]});
+      let filePath = dialog.showOpenDialog(remote.getCurrentWindow(), {filters: [{name: 'PCAP File', extensions: ['pcap', 'pcapng']}]});
       if (filePath != null) {
         this._open(filePath[0])
       }
@@ -130,37 +49,23 @@ export default class PcapFile {
 
     PubSub.on(this, 'pcap-file:save', () => {
       if (selectedSession) {
-        let filePath = dialog.showSaveDialog(remote.getCurrentWindow(), {filters: [{name: 'PCAP File', extensions: ['pcap']}]});
+        let filePath = dialog.showSaveDialog(remote.getCurrentWindow(), {filters: [{name: 'PCAP File', extensions: ['pcap', 'pcapng']}]});
         if (filePath != null) {
-          let stream = fs.createWriteStream(filePath);
-          let packets = [];
-          for (let i = 1;;++i) {
-            let pkt = selectedSession.get(i);
-            if (!pkt.seq) break;
-            packets.push(pkt);
-          }
-
-          let header = Buffer.alloc(24);
-          header.writeUInt32BE(0x4d3cb2a1, 0);                // magicNumber
-          header.writeUInt16LE(2, 4);                         // versionMajor
-          header.writeUInt16LE(4, 6);                         // versionMinor
-          header.writeInt16LE(0, 8);                          // thiszone
-          header.writeUInt32LE(0, 12);                        // sigfigs
-          header.writeUInt32LE(selectedSession.snaplen, 16);  // snaplen
-          header.writeUInt32LE(1, 20);                        // network
-          stream.write(header);
-
-          for (let pkt of packets) {
-            let pktHeader = Buffer.alloc(16);
-            pktHeader.writeUInt32LE(pkt.ts_sec, 0);
-            pktHeader.writeUInt32LE(pkt.ts_nsec, 4);
-            pktHeader.writeUInt32LE(pkt.payload.length, 8);
-            pktHeader.writeUInt32LE(pkt.length, 12);
-            stream.write(pktHeader);
-            stream.write(pkt.payload);
-          }
-
-          stream.end();
+          let start = new Date();
+          selectedSession.export(filePath).then((progress) => {
+            let elapsed = ((new Date()).getTime() - start.getTime()) / 1000.0;
+            PubSub.pub('core:log', {
+              level: 'debug',
+              message: `pcap-file: exported ${progress.packets} packets ${elapsed} sec`,
+              timestamp: new Date()
+            });
+          }).catch((err) => {
+            PubSub.pub('core:log', {
+              level: 'error',
+              message: `pcap-file: ${err.message}`,
+              timestamp: new Date()
+            });
+          });
         }
       }
     });
@@ -171,7 +76,6 @@ export default class PcapFile {
   }
 
   async _open(filePath) {
-    let pcap = new Pcap(filePath);
     let sess = await Session.create({name: path.basename(filePath)});
     for (let err of sess.errors) {
       //Logger.error(err.message);
@@ -188,7 +92,16 @@ export default class PcapFile {
         data: log.data
       });
     });
-    sess.analyze(pcap.packets);
+    try {
+      sess.load(filePath);
+    } catch (err) {
+      PubSub.pub('core:log', {
+        level: 'error',
+        message: `pcap-file: ${err.message}`,
+        timestamp: new Date()
+      });
+      return;
+    }
     let start = new Date();
     sess.on('status', stat => {
       if (stat.packets > 0 && stat.queue === 0) {
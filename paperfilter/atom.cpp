@@ -0,0 +1,91 @@
+#include "atom.hpp"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+const uint32_t chunkBits = 12;
+const uint32_t chunkSize = 1 << chunkBits;
+const uint32_t maxChunks = 1 << 16;
+const size_t shardCount = 16;
+
+struct Shard {
+  std::mutex mutex;
+  std::unordered_map<std::string, uint32_t> ids;
+};
+
+// Strings live in fixed-size chunks that never move, so str() needs no lock.
+// Interning locks one shard of the reverse map; an atom is published through
+// the map only after its string has been stored.
+class Table {
+public:
+  Table() : next(1) {
+    for (auto &chunk : chunks)
+      chunk.store(nullptr, std::memory_order_relaxed);
+    chunks[0].store(new std::string[chunkSize]);
+  }
+
+  uint32_t intern(const std::string &str) {
+    if (str.empty())
+      return 0;
+    Shard &shard = shards[std::hash<std::string>()(str) % shardCount];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.ids.find(str);
+    if (it != shard.ids.end())
+      return it->second;
+
+    uint32_t id = next.fetch_add(1);
+    if (id >= chunkSize * maxChunks)
+      return 0;
+    std::atomic<std::string *> &slot = chunks[id >> chunkBits];
+    std::string *chunk = slot.load(std::memory_order_acquire);
+    if (!chunk) {
+      std::string *fresh = new std::string[chunkSize];
+      if (slot.compare_exchange_strong(chunk, fresh)) {
+        chunk = fresh;
+      } else {
+        delete[] fresh;
+      }
+    }
+    chunk[id & (chunkSize - 1)] = str;
+    shard.ids.emplace(str, id);
+    return id;
+  }
+
+  uint32_t find(const std::string &str) {
+    Shard &shard = shards[std::hash<std::string>()(str) % shardCount];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.ids.find(str);
+    return it != shard.ids.end() ? it->second : 0;
+  }
+
+  const std::string &str(uint32_t id) const {
+    const std::string *chunk =
+        chunks[id >> chunkBits].load(std::memory_order_acquire);
+    return chunk[id & (chunkSize - 1)];
+  }
+
+private:
+  Shard shards[shardCount];
+  std::atomic<uint32_t> next;
+  std::atomic<std::string *> chunks[maxChunks];
+};
+
+// Never destroyed; atoms may still be read by threads during exit.
+Table &table() {
+  static Table *table = new Table();
+  return *table;
+}
+}
+
+Atom::Atom(const std::string &str) : id(table().intern(str)) {}
+
+Atom::Atom(const char *str) : id(table().intern(str)) {}
+
+Atom Atom::find(const std::string &str) {
+  Atom atom;
+  atom.id = table().find(str);
+  return atom;
+}
+
+const std::string &Atom::str() const { return table().str(id); }
@@ -0,0 +1,38 @@
+#ifndef ATOM_HPP
+#define ATOM_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Handle to a string in the process-wide intern table. Atoms compare and hash
+// as integers, and each string is stored once for the life of the process,
+// so they are only meant for identifiers from a bounded set such as layer
+// namespaces and item ids.
+class Atom {
+public:
+  Atom() : id(0) {}
+  explicit Atom(const std::string &str);
+  explicit Atom(const char *str);
+
+  // Returns the empty atom instead of interning an unknown string.
+  static Atom find(const std::string &str);
+
+  const std::string &str() const;
+  uint32_t value() const { return id; }
+  bool empty() const { return id == 0; }
+
+  bool operator==(Atom other) const { return id == other.id; }
+  bool operator!=(Atom other) const { return id != other.id; }
+
+private:
+  uint32_t id;
+};
+
+namespace std {
+template <> struct hash<Atom> {
+  size_t operator()(Atom atom) const { return atom.value(); }
+};
+}
+
+#endif
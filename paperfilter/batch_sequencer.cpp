@@ -0,0 +1,27 @@
+#include "batch_sequencer.hpp"
+#include "packet.hpp"
+
+BatchSequencer::BatchSequencer(const Callback &cb) : cb(cb), tickets(0) {}
+
+BatchSequencer::~BatchSequencer() {}
+
+uint64_t BatchSequencer::ticket() { return tickets++; }
+
+void BatchSequencer::push(uint64_t ticket,
+                          std::vector<std::unique_ptr<Packet>> packets) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (ticket != next) {
+    pending[ticket] = std::move(packets);
+    return;
+  }
+
+  if (cb)
+    cb(std::move(packets));
+  ++next;
+
+  for (auto it = pending.begin(); it != pending.end() && it->first == next;
+       it = pending.erase(it), ++next) {
+    if (cb)
+      cb(std::move(it->second));
+  }
+}
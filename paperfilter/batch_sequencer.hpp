@@ -0,0 +1,33 @@
+#ifndef BATCH_SEQUENCER_HPP
+#define BATCH_SEQUENCER_HPP
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class Packet;
+
+class BatchSequencer {
+public:
+  typedef std::function<void(std::vector<std::unique_ptr<Packet>>)> Callback;
+
+public:
+  BatchSequencer(const Callback &cb);
+  ~BatchSequencer();
+  BatchSequencer(const BatchSequencer &) = delete;
+  BatchSequencer &operator=(const BatchSequencer &) = delete;
+  uint64_t ticket();
+  void push(uint64_t ticket, std::vector<std::unique_ptr<Packet>> packets);
+
+private:
+  Callback cb;
+  std::atomic<uint64_t> tickets;
+  std::mutex mutex;
+  uint64_t next = 0;
+  std::map<uint64_t, std::vector<std::unique_ptr<Packet>>> pending;
+};
+
+#endif
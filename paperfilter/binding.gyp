@@ -10,19 +10,39 @@
             "log_message.cpp",
             "console.cpp",
             "buffer.cpp",
+            "capture_writer.cpp",
+            "payload_arena.cpp",
+            "payload_pin.cpp",
             "large_buffer.cpp",
+            "atom.cpp",
             "layer.cpp",
             "item.cpp",
             "item_value.cpp",
             "session.cpp",
             "packet.cpp",
+            "packet_exporter.cpp",
+            "packet_replayer.cpp",
+            "pcapng.cpp",
+            "pcap_file_reader.cpp",
+            "pcap_parser.cpp",
+            "prefilter.cpp",
             "packet_store.cpp",
             "packet_dispatcher.cpp",
+            "packet_queue.cpp",
+            "flow_hash.cpp",
+            "packet_batcher.cpp",
+            "batch_sequencer.cpp",
             "filtered_packet_store.cpp",
             "stream_chunk.cpp",
             "paper_context.cpp",
+            "script_cache.cpp",
+            "startup_snapshot.cpp",
             "dissector.cpp",
             "dissector_thread.cpp",
+            "native_dissector.cpp",
+            "namespace_matcher.cpp",
+            "dissector_plugin.cpp",
+            "work_deque.cpp",
             "stream_dissector_thread.cpp",
             "filter.cpp",
             "filter_thread.cpp",
@@ -48,7 +68,9 @@
                {
                   "sources":[
                      "linux/permission.cpp",
-                     "linux/pcap.cpp"
+                     "linux/pcap.cpp",
+                     "linux/device_registry.cpp",
+                     "linux/packet_ring.cpp"
                   ],
                   "include_dirs":[
                      "linux"
@@ -77,9 +77,8 @@ public:
   ~Private();
 
 public:
-  std::shared_ptr<std::vector<char>> source =
-      std::make_shared<std::vector<char>>();
-  std::shared_ptr<bool> readonly = std::make_shared<bool>(false);
+  std::shared_ptr<const char> source;
+  bool readonly = false;
   size_t start = 0;
   size_t end = 0;
 };
@@ -92,8 +91,22 @@ Buffer::Buffer() : d(new Private()) {}
 
 Buffer::Buffer(const std::shared_ptr<std::vector<char>> &source)
     : d(new Private()) {
-  d->source = source;
-  d->end = d->source->size();
+  d->source = std::shared_ptr<const char>(source, source->data());
+  d->end = source->size();
+}
+
+Buffer::Buffer(const std::shared_ptr<std::vector<char>> &source, size_t start,
+               size_t end)
+    : d(new Private()) {
+  d->source = std::shared_ptr<const char>(source, source->data());
+  d->start = std::min(start, source->size());
+  d->end = std::min(std::max(start, end), source->size());
+}
+
+Buffer::Buffer(const std::shared_ptr<const char> &data, size_t length)
+    : d(new Private()) {
+  d->source = data;
+  d->end = length;
 }
 
 Buffer::Buffer(const v8::FunctionCallbackInfo<v8::Value> &args)
@@ -138,8 +151,8 @@ Buffer::Buffer(const v8::FunctionCallbackInfo<v8::Value> &args)
         isolate, "First argument must be a string, Buffer, or Array"));
   }
 
-  d->source = buf;
-  d->end = d->source->size();
+  d->source = std::shared_ptr<const char>(buf, buf->data());
+  d->end = buf->size();
 }
 
 Buffer::~Buffer() {}
@@ -147,10 +160,11 @@ Buffer::~Buffer() {}
 size_t Buffer::length() const { return d->end - d->start; }
 
 std::unique_ptr<Buffer> Buffer::slice(size_t start, size_t end) const {
-  std::unique_ptr<Buffer> buf(new Buffer(d->source));
+  size_t s = std::min(d->start + start, d->end);
+  size_t e = end > start ? std::min(s + (end - start), d->end) : s;
+  std::unique_ptr<Buffer> buf(new Buffer(d->source, e));
+  buf->d->start = s;
   buf->d->readonly = d->readonly;
-  buf->d->start = std::min(d->start + start, d->source->size());
-  buf->d->end = std::min(buf->d->start + (end - start), d->end);
   return buf;
 }
 
@@ -337,7 +351,7 @@ void Buffer::get(uint32_t index,
 }
 
 const char *Buffer::data(size_t offset) const {
-  return d->source->data() + d->start + offset;
+  return d->source.get() + d->start + offset;
 }
 
 void Buffer::from(const v8::FunctionCallbackInfo<v8::Value> &args) {
@@ -376,4 +390,4 @@ bool Buffer::isBuffer(const v8::Local<v8::Value> &value) {
   return v8pp::class_<Buffer>::unwrap_object(Isolate::GetCurrent(), value);
 }
 
-void Buffer::freeze() { *d->readonly = true; }
+void Buffer::freeze() { d->readonly = true; }
@@ -9,6 +9,9 @@ class Buffer {
 public:
   Buffer();
   Buffer(const std::shared_ptr<std::vector<char>> &source);
+  Buffer(const std::shared_ptr<std::vector<char>> &source, size_t start,
+         size_t end);
+  Buffer(const std::shared_ptr<const char> &data, size_t length);
   explicit Buffer(const v8::FunctionCallbackInfo<v8::Value> &args);
   ~Buffer();
   Buffer(const Buffer &) = delete;
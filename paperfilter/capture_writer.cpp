@@ -0,0 +1,402 @@
+#include "capture_writer.hpp"
+#include "buffer.hpp"
+#include "log_message.hpp"
+#include "packet.hpp"
+#include "pcapng.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace {
+const std::chrono::milliseconds flushInterval(500);
+const size_t dateLength = 14; // YYYYmmddHHMMSS
+
+struct Block {
+  std::vector<char> data;
+  size_t used = 0;
+  uint32_t packets = 0;
+  uint32_t interfaces = 0;
+};
+
+// Splits path into <dir><base><ext>; dir keeps its trailing separator.
+void splitPath(const std::string &path, std::string *dir, std::string *base,
+               std::string *ext) {
+  std::string stem = path;
+  ext->assign(".pcapng");
+  size_t dot = stem.find_last_of('.');
+  size_t sep = stem.find_last_of("/\\");
+  if (dot != std::string::npos && (sep == std::string::npos || dot > sep)) {
+    ext->assign(stem.substr(dot));
+    stem.resize(dot);
+  }
+  const size_t start = sep == std::string::npos ? 0 : sep + 1;
+  dir->assign(stem.substr(0, start));
+  base->assign(stem.substr(start));
+}
+
+std::vector<std::string> listDirectory(const std::string &dir) {
+  std::vector<std::string> names;
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE handle = FindFirstFileA((dir + "\\*").c_str(), &data);
+  if (handle == INVALID_HANDLE_VALUE)
+    return names;
+  do {
+    names.push_back(data.cFileName);
+  } while (FindNextFileA(handle, &data));
+  FindClose(handle);
+#else
+  DIR *d = opendir(dir.c_str());
+  if (!d)
+    return names;
+  while (dirent *entry = readdir(d)) {
+    names.push_back(entry->d_name);
+  }
+  closedir(d);
+#endif
+  return names;
+}
+
+// Returns the index of a file named <base>_<index>_<date><ext>, or 0.
+unsigned fileIndexOf(const std::string &name, const std::string &base,
+                     const std::string &ext) {
+  const std::string &prefix = base + "_";
+  if (name.size() < prefix.size() + ext.size() ||
+      name.compare(0, prefix.size(), prefix) != 0 ||
+      name.compare(name.size() - ext.size(), ext.size(), ext) != 0)
+    return 0;
+  const std::string &rest =
+      name.substr(prefix.size(), name.size() - prefix.size() - ext.size());
+  size_t sep = rest.find('_');
+  if (sep == 0 || sep > 9 || sep == std::string::npos ||
+      rest.size() - sep - 1 != dateLength)
+    return 0;
+  unsigned index = 0;
+  for (size_t i = 0; i < rest.size(); ++i) {
+    if (i == sep)
+      continue;
+    if (rest[i] < '0' || rest[i] > '9')
+      return 0;
+    if (i < sep)
+      index = index * 10 + (rest[i] - '0');
+  }
+  return index;
+}
+}
+
+class CaptureWriter::Private {
+public:
+  Private(const std::shared_ptr<Context> &ctx);
+  ~Private();
+  void run();
+  void scanFiles();
+  bool openFile(std::string *error);
+  void closeFile();
+  void writeBlock(Block *block);
+  void log(LogMessage::Level level, const std::string &message);
+
+public:
+  std::shared_ptr<Context> ctx;
+
+  std::vector<std::unique_ptr<Block>> blocks;
+  std::vector<Block *> freeBlocks;
+  std::deque<Block *> ready;
+  Block *current = nullptr;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::thread thread;
+  bool closed = false;
+
+  FILE *file = nullptr;
+  uint64_t fileBytes = 0;
+  uint32_t fileInterfaces = 0;
+  std::atomic<uint32_t> fileIndex;
+  std::atomic<uint32_t> fileCount;
+  std::chrono::steady_clock::time_point fileStart;
+  std::deque<std::string> files;
+  mutable std::mutex fileNameMutex;
+  std::string fileName;
+
+  std::atomic<uint64_t> packets;
+  std::atomic<uint64_t> bytes;
+  std::atomic<uint64_t> dropped;
+};
+
+CaptureWriter::Private::Private(const std::shared_ptr<Context> &ctx)
+    : ctx(ctx), fileIndex(0), fileCount(0), packets(0), bytes(0),
+      dropped(0) {}
+
+CaptureWriter::Private::~Private() {}
+
+void CaptureWriter::Private::log(LogMessage::Level level,
+                                 const std::string &message) {
+  if (!ctx->logCb)
+    return;
+  LogMessage msg;
+  msg.level = level;
+  msg.message = message;
+  msg.domain = "capture-file";
+  ctx->logCb(msg);
+}
+
+// Files left by earlier runs count towards maxFiles, and numbering
+// continues after the highest index found.
+void CaptureWriter::Private::scanFiles() {
+  std::string dir;
+  std::string base;
+  std::string ext;
+  splitPath(ctx->path, &dir, &base, &ext);
+
+  std::vector<std::pair<unsigned, std::string>> found;
+  for (const std::string &name : listDirectory(dir.empty() ? "." : dir)) {
+    if (unsigned index = fileIndexOf(name, base, ext))
+      found.emplace_back(index, name);
+  }
+  std::sort(found.begin(), found.end());
+
+  files.clear();
+  for (const auto &pair : found) {
+    files.push_back(dir + pair.second);
+  }
+  fileIndex = found.empty() ? 0 : found.back().first;
+}
+
+bool CaptureWriter::Private::openFile(std::string *error) {
+  std::string dir;
+  std::string base;
+  std::string ext;
+  splitPath(ctx->path, &dir, &base, &ext);
+  const std::string &stem = dir + base;
+
+  std::time_t now = std::time(nullptr);
+  std::tm tm;
+#ifdef _WIN32
+  localtime_s(&tm, &now);
+#else
+  localtime_r(&now, &tm);
+#endif
+  char suffix[32];
+  unsigned index = ++fileIndex;
+  snprintf(suffix, sizeof(suffix), "_%05u_", index);
+  char date[16];
+  strftime(date, sizeof(date), "%Y%m%d%H%M%S", &tm);
+  const std::string &name = stem + suffix + date + ext;
+
+  file = fopen(name.c_str(), "wb");
+  if (!file) {
+    error->assign(name + ": " + strerror(errno));
+    return false;
+  }
+  // Blocks are written whole, so stdio buffering would only add a copy.
+  setvbuf(file, nullptr, _IONBF, 0);
+
+  char shb[Pcapng::shbSize];
+  Pcapng::writeSHB(shb);
+  if (fwrite(shb, 1, sizeof(shb), file) != sizeof(shb)) {
+    error->assign(name + ": " + strerror(errno));
+    fclose(file);
+    file = nullptr;
+    return false;
+  }
+  fileBytes = sizeof(shb);
+  fileInterfaces = 0;
+  ++fileCount;
+  fileStart = std::chrono::steady_clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(fileNameMutex);
+    fileName = name;
+  }
+  files.push_back(name);
+  while (ctx->maxFiles > 0 && files.size() > ctx->maxFiles) {
+    if (remove(files.front().c_str()) != 0) {
+      log(LogMessage::LEVEL_WARN, files.front() + ": " + strerror(errno));
+    }
+    files.pop_front();
+  }
+  return true;
+}
+
+void CaptureWriter::Private::closeFile() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+}
+
+void CaptureWriter::Private::writeBlock(Block *block) {
+  bool rotate = false;
+  if (file && fileBytes > Pcapng::shbSize) {
+    if (ctx->rotateSize > 0 && fileBytes + block->used > ctx->rotateSize)
+      rotate = true;
+    if (ctx->rotateInterval > 0 &&
+        std::chrono::steady_clock::now() - fileStart >=
+            std::chrono::seconds(ctx->rotateInterval))
+      rotate = true;
+  }
+
+  if (rotate || !file) {
+    closeFile();
+    std::string error;
+    if (!openFile(&error)) {
+      log(LogMessage::LEVEL_ERROR, error);
+      dropped += block->packets;
+      return;
+    }
+  }
+
+  // IDBs may appear anywhere in a section before the first packet that
+  // refers to them.
+  for (; fileInterfaces < block->interfaces; ++fileInterfaces) {
+    char idb[Pcapng::idbSize];
+    Pcapng::writeIDB(idb, ctx->linkType, ctx->snaplen);
+    if (fwrite(idb, 1, sizeof(idb), file) != sizeof(idb))
+      break;
+    fileBytes += sizeof(idb);
+  }
+
+  if (fileInterfaces < block->interfaces ||
+      fwrite(block->data.data(), 1, block->used, file) != block->used) {
+    log(LogMessage::LEVEL_ERROR, fileName + ": " + strerror(errno));
+    dropped += block->packets;
+    closeFile();
+    return;
+  }
+  fileBytes += block->used;
+  packets += block->packets;
+  bytes += block->used;
+}
+
+void CaptureWriter::Private::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    cond.wait_for(lock, flushInterval,
+                  [this] { return closed || !ready.empty(); });
+
+    // Partially filled blocks are written after a while so that the files
+    // stay current on quiet links.
+    if (ready.empty() && current && current->used > 0) {
+      ready.push_back(current);
+      current = nullptr;
+    }
+    if (ready.empty()) {
+      if (closed)
+        break;
+      continue;
+    }
+
+    Block *block = ready.front();
+    ready.pop_front();
+    lock.unlock();
+    writeBlock(block);
+    block->used = 0;
+    block->packets = 0;
+    block->interfaces = 0;
+    lock.lock();
+    freeBlocks.push_back(block);
+  }
+  lock.unlock();
+  closeFile();
+}
+
+CaptureWriter::CaptureWriter(const std::shared_ptr<Context> &ctx)
+    : d(new Private(ctx)) {}
+
+CaptureWriter::~CaptureWriter() { close(); }
+
+bool CaptureWriter::open(std::string *error) {
+  if (d->thread.joinable())
+    return true;
+  if (d->ctx->path.empty()) {
+    error->assign("no capture file path");
+    return false;
+  }
+  d->scanFiles();
+  if (!d->openFile(error))
+    return false;
+
+  // Every buffer is allocated up front; push() never allocates, and drops
+  // packets instead of waiting when the disk falls behind.
+  for (uint32_t i = 0; i < std::max(d->ctx->bufferCount, 2u); ++i) {
+    std::unique_ptr<Block> block(new Block());
+    block->data.resize(d->ctx->bufferSize);
+    d->freeBlocks.push_back(block.get());
+    d->blocks.push_back(std::move(block));
+  }
+  d->closed = false;
+  d->thread = std::thread([this]() { d->run(); });
+  return true;
+}
+
+void CaptureWriter::push(const Packet &pkt) {
+  std::unique_ptr<Buffer> payload = pkt.payload();
+  uint32_t caplen = payload ? payload->length() : 0;
+  size_t size = Pcapng::epbSize(caplen);
+
+  std::lock_guard<std::mutex> lock(d->mutex);
+  if (!d->thread.joinable() || d->closed || size > d->ctx->bufferSize) {
+    ++d->dropped;
+    return;
+  }
+  if (d->current && d->current->used + size > d->current->data.size()) {
+    d->ready.push_back(d->current);
+    d->current = nullptr;
+    d->cond.notify_one();
+  }
+  if (!d->current) {
+    if (d->freeBlocks.empty()) {
+      ++d->dropped;
+      return;
+    }
+    d->current = d->freeBlocks.back();
+    d->freeBlocks.pop_back();
+  }
+
+  Block *block = d->current;
+  uint64_t ts = pkt.ts_sec() * 1000000000ull + pkt.ts_nsec();
+  Pcapng::writeEPB(&block->data[block->used], pkt.interfaceIndex(), ts, caplen,
+                   pkt.length(), payload ? payload->data() : nullptr);
+  block->used += size;
+  block->packets++;
+  block->interfaces = std::max(block->interfaces, pkt.interfaceIndex() + 1);
+}
+
+void CaptureWriter::close() {
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->closed = true;
+  }
+  d->cond.notify_one();
+  if (d->thread.joinable())
+    d->thread.join();
+  d->closeFile();
+}
+
+CaptureWriter::Stats CaptureWriter::stats() const {
+  Stats stats;
+  stats.packets = d->packets;
+  stats.bytes = d->bytes;
+  stats.dropped = d->dropped;
+  stats.files = d->fileCount;
+  return stats;
+}
+
+std::string CaptureWriter::currentFile() const {
+  std::lock_guard<std::mutex> lock(d->fileNameMutex);
+  return d->fileName;
+}
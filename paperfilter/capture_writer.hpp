@@ -0,0 +1,51 @@
+#ifndef CAPTURE_WRITER_HPP
+#define CAPTURE_WRITER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+class Packet;
+struct LogMessage;
+
+class CaptureWriter {
+public:
+  struct Context {
+    // Files are named <stem>_<NNNNN>_<YYYYmmddHHMMSS>.pcapng after this path.
+    std::string path;
+    uint64_t rotateSize = 0;     // bytes, 0 to disable
+    uint32_t rotateInterval = 0; // seconds, 0 to disable
+    uint32_t maxFiles = 0;       // oldest removed, also from earlier runs
+    uint32_t bufferSize = 4 << 20;
+    uint32_t bufferCount = 8;
+    int linkType = 1; // DLT_EN10MB
+    uint32_t snaplen = 65535;
+    std::function<void(const LogMessage &)> logCb;
+  };
+
+  struct Stats {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+    uint32_t files = 0;
+  };
+
+public:
+  CaptureWriter(const std::shared_ptr<Context> &ctx);
+  ~CaptureWriter();
+  CaptureWriter(const CaptureWriter &) = delete;
+  CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+  bool open(std::string *error);
+  void push(const Packet &pkt);
+  void close();
+  Stats stats() const;
+  std::string currentFile() const;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "pcap.hpp"
 #include "../packet.hpp"
 #include "../log_message.hpp"
+#include "../packet_batcher.hpp"
 #include <mutex>
 #include <pcap.h>
 #include <signal.h>
@@ -9,21 +10,98 @@
 class Pcap::Private {
 public:
   Private(const std::shared_ptr<Context> &ctx);
+  void log(LogMessage::Level level, const std::string &message);
+  pcap_t *open();
+  void addStats(Stats *total) const;
+  PacketBatcher::Callback batchCallback();
 
 public:
   std::mutex mutex;
   std::thread thread;
   pcap_t *pcap = nullptr;
+  bool nanosecond = false;
 
   std::shared_ptr<Context> ctx;
   bpf_program bpf = {0, nullptr};
   std::string networkInterface;
   bool promiscuous = false;
   int snaplen = 2048;
+  Backend backend = BACKEND_PCAP;
+  RingOption ringOption;
+  PcapOption pcapOption;
+  BatchOption batchOption;
+
+  // Counters of handles that have already been closed, so that stats() keeps
+  // growing across restarts.
+  Stats closedStats;
 };
 
 Pcap::Private::Private(const std::shared_ptr<Context> &ctx) : ctx(ctx) {}
 
+void Pcap::Private::log(LogMessage::Level level, const std::string &message) {
+  if (ctx->logCb) {
+    LogMessage msg;
+    msg.level = level;
+    msg.message = message;
+    msg.domain = "pcap";
+    ctx->logCb(msg);
+  }
+}
+
+pcap_t *Pcap::Private::open() {
+  char err[PCAP_ERRBUF_SIZE] = {'\0'};
+  pcap_t *p = pcap_create(networkInterface.c_str(), err);
+  if (!p) {
+    log(LogMessage::LEVEL_ERROR, std::string("pcap_create() failed: ") + err);
+    return nullptr;
+  }
+
+  pcap_set_snaplen(p, snaplen);
+  pcap_set_promisc(p, promiscuous);
+  pcap_set_timeout(p, pcapOption.timeout);
+  if (pcapOption.bufferSize > 0)
+    pcap_set_buffer_size(p, pcapOption.bufferSize);
+  pcap_set_immediate_mode(p, pcapOption.immediate);
+  if (pcapOption.nanosecond)
+    pcap_set_tstamp_precision(p, PCAP_TSTAMP_PRECISION_NANO);
+
+  int status = pcap_activate(p);
+  if (status < 0) {
+    log(LogMessage::LEVEL_ERROR, std::string("pcap_activate() failed: ") +
+                                     pcap_statustostr(status) + ": " +
+                                     pcap_geterr(p));
+    pcap_close(p);
+    return nullptr;
+  } else if (status > 0) {
+    log(LogMessage::LEVEL_WARN,
+        std::string("pcap_activate(): ") + pcap_statustostr(status));
+  }
+
+  nanosecond = pcap_get_tstamp_precision(p) == PCAP_TSTAMP_PRECISION_NANO;
+  return p;
+}
+
+void Pcap::Private::addStats(Stats *total) const {
+  pcap_stat ps;
+  if (pcap && pcap_stats(pcap, &ps) == 0) {
+    total->received += ps.ps_recv;
+    total->dropped += ps.ps_drop;
+    total->ifdropped += ps.ps_ifdrop;
+  }
+}
+
+PacketBatcher::Callback Pcap::Private::batchCallback() {
+  return [this](std::vector<std::unique_ptr<Packet>> packets) {
+    if (ctx->packetsCb) {
+      ctx->packetsCb(std::move(packets));
+    } else if (ctx->packetCb) {
+      for (auto &pkt : packets) {
+        ctx->packetCb(std::move(pkt));
+      }
+    }
+  };
+}
+
 Pcap::Pcap(const std::shared_ptr<Context> &ctx) : d(new Private(ctx)) {}
 
 Pcap::~Pcap() { stop(); }
@@ -59,6 +137,36 @@ std::vector<Pcap::Device> Pcap::devices() {
   return devs;
 }
 
+bool Pcap::compile(const std::string &filter, int linkType, int snaplen,
+                   std::vector<Instruction> *program, std::string *error) {
+  pcap_t *pcap = pcap_open_dead(linkType, snaplen);
+  if (!pcap) {
+    if (error)
+      error->assign("pcap_open_dead() failed");
+    return false;
+  }
+
+  bpf_program bpf;
+  if (pcap_compile(pcap, &bpf, filter.c_str(), true, PCAP_NETMASK_UNKNOWN) <
+      0) {
+    if (error)
+      error->assign(pcap_geterr(pcap));
+    pcap_close(pcap);
+    return false;
+  }
+
+  program->clear();
+  for (u_int i = 0; i < bpf.bf_len; ++i) {
+    const bpf_insn &insn = bpf.bf_insns[i];
+    Instruction inst = {insn.code, insn.jt, insn.jf, insn.k};
+    program->push_back(inst);
+  }
+
+  pcap_freecode(&bpf);
+  pcap_close(pcap);
+  return true;
+}
+
 void Pcap::setInterface(const std::string &ifs) { d->networkInterface = ifs; }
 
 std::string Pcap::networkInterface() const { return d->networkInterface; }
@@ -100,50 +208,75 @@ bool Pcap::setBPF(const std::string &filter, std::string *error) {
   return true;
 }
 
+void Pcap::setBackend(Backend backend) { d->backend = backend; }
+
+Pcap::Backend Pcap::backend() const { return d->backend; }
+
+void Pcap::setRingOption(const RingOption &option) { d->ringOption = option; }
+
+Pcap::RingOption Pcap::ringOption() const { return d->ringOption; }
+
+void Pcap::setPcapOption(const PcapOption &option) { d->pcapOption = option; }
+
+Pcap::PcapOption Pcap::pcapOption() const { return d->pcapOption; }
+
+void Pcap::setBatchOption(const BatchOption &option) {
+  d->batchOption = option;
+}
+
+Pcap::BatchOption Pcap::batchOption() const { return d->batchOption; }
+
+Pcap::Stats Pcap::stats() const {
+  std::lock_guard<std::mutex> lock(d->mutex);
+  Stats total = d->closedStats;
+  d->addStats(&total);
+  return total;
+}
+
 void Pcap::start() {
   stop();
 
   std::lock_guard<std::mutex> lock(d->mutex);
-  char err[PCAP_ERRBUF_SIZE] = {'\0'};
 
-  d->pcap = pcap_open_live(d->networkInterface.c_str(), d->snaplen,
-                           d->promiscuous, 1, err);
-  if (!d->pcap) {
-    if (d->ctx->logCb) {
-      LogMessage msg;
-      msg.level = LogMessage::LEVEL_ERROR;
-      msg.message = std::string("pcap_open_live() failed: ") + err;
-      msg.domain = "pcap";
-      d->ctx->logCb(msg);
-    }
-    return;
+  if (d->backend == BACKEND_RING) {
+    d->log(LogMessage::LEVEL_WARN,
+           "ring backend is not supported on this platform");
   }
 
+  d->pcap = d->open();
+  if (!d->pcap)
+    return;
+
   if (d->bpf.bf_len > 0 && pcap_setfilter(d->pcap, &d->bpf) < 0) {
-    if (d->ctx->logCb) {
-      LogMessage msg;
-      msg.level = LogMessage::LEVEL_ERROR;
-      msg.message = "pcap_setfilter() failed";
-      msg.domain = "pcap";
-      d->ctx->logCb(msg);
-    }
+    d->log(LogMessage::LEVEL_ERROR, "pcap_setfilter() failed");
     pcap_close(d->pcap);
     d->pcap = nullptr;
     return;
   }
 
   d->thread = std::thread([this]() {
-    pcap_loop(
-        d->pcap,
-        0, [](u_char *user, const struct pcap_pkthdr *h, const u_char *bytes) {
-          Pcap &self = *reinterpret_cast<Pcap *>(user);
-          if (self.d->ctx->packetCb) {
-            self.d->ctx->packetCb(
-                std::unique_ptr<Packet>(new Packet(h, bytes)));
-          }
-        }, reinterpret_cast<u_char *>(this));
+    struct Handler {
+      PacketBatcher *batcher;
+      bool nanosecond;
+    };
+    PacketBatcher batcher(d->batchCallback(), d->batchOption.size,
+                          d->batchOption.timeout);
+    Handler handler = {&batcher, d->nanosecond};
+    while (pcap_dispatch(d->pcap, -1,
+                         [](u_char *user, const struct pcap_pkthdr *h,
+                            const u_char *bytes) {
+                           Handler &handler =
+                               *reinterpret_cast<Handler *>(user);
+                           handler.batcher->push(std::unique_ptr<Packet>(
+                               new Packet(h, bytes, handler.nanosecond)));
+                         },
+                         reinterpret_cast<u_char *>(&handler)) >= 0) {
+      batcher.poll();
+    }
+    batcher.flush();
     {
       std::lock_guard<std::mutex> lock(d->mutex);
+      d->addStats(&d->closedStats);
       pcap_close(d->pcap);
       d->pcap = nullptr;
     }
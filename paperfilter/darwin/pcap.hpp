@@ -1,6 +1,7 @@
 #ifndef PCAP_HPP
 #define PCAP_HPP
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -13,8 +14,40 @@ class Pcap {
 public:
   struct Context {
     std::function<void(std::unique_ptr<Packet>)> packetCb;
+    std::function<void(std::vector<std::unique_ptr<Packet>>)> packetsCb;
     std::function<void(const LogMessage &)> logCb;
   };
+  enum Backend { BACKEND_PCAP, BACKEND_RING };
+  enum FanoutMode { FANOUT_HASH, FANOUT_CPU, FANOUT_LB };
+  struct RingOption {
+    int blockSize = 1 << 22;
+    int blockCount = 64;
+    int blockTimeout = 64;
+    int fanout = 1;
+    FanoutMode fanoutMode = FANOUT_HASH;
+  };
+  struct PcapOption {
+    int bufferSize = 0;
+    int timeout = 1;
+    bool immediate = false;
+    bool nanosecond = true;
+  };
+  struct BatchOption {
+    size_t size = 1024;
+    int timeout = 10;
+  };
+  struct Stats {
+    uint64_t received = 0;
+    uint64_t dropped = 0;
+    uint64_t ifdropped = 0;
+    uint64_t freezes = 0;
+  };
+  struct Instruction {
+    uint16_t code;
+    uint8_t jt;
+    uint8_t jf;
+    uint32_t k;
+  };
   struct Device {
     std::string id;
     std::string name;
@@ -27,6 +60,8 @@ public:
   Pcap(const std::shared_ptr<Context> &ctx);
   ~Pcap();
   static std::vector<Device> devices();
+  static bool compile(const std::string &filter, int linkType, int snaplen,
+                      std::vector<Instruction> *program, std::string *error);
   void setInterface(const std::string &ifs);
   std::string networkInterface() const;
   void setPromiscuous(bool promisc);
@@ -34,6 +69,15 @@ public:
   void setSnaplen(int len);
   int snaplen() const;
   bool setBPF(const std::string &filter, std::string *error);
+  void setBackend(Backend backend);
+  Backend backend() const;
+  void setRingOption(const RingOption &option);
+  RingOption ringOption() const;
+  void setPcapOption(const PcapOption &option);
+  PcapOption pcapOption() const;
+  void setBatchOption(const BatchOption &option);
+  BatchOption batchOption() const;
+  Stats stats() const;
 
   void start();
   void stop();
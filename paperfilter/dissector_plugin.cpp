@@ -0,0 +1,204 @@
+#include "dissector_plugin.h"
+#include "buffer.hpp"
+#include "item.hpp"
+#include "item_value.hpp"
+#include "layer.hpp"
+#include "native_dissector.hpp"
+#include <mutex>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+struct pf_context {
+  const Layer *parent;
+  std::unique_ptr<Buffer> payload;
+  std::vector<std::shared_ptr<Layer>> *layers;
+};
+
+namespace {
+Layer *toLayer(pf_layer *layer) { return reinterpret_cast<Layer *>(layer); }
+
+Item *toItem(pf_item *item) { return reinterpret_cast<Item *>(item); }
+
+std::string str(const char *s) { return s ? s : ""; }
+
+std::unique_ptr<Buffer> slice(pf_context *ctx, size_t offset, size_t length) {
+  if (!ctx->payload)
+    return std::unique_ptr<Buffer>(new Buffer());
+  return ctx->payload->slice(offset, offset + length);
+}
+
+const char *parentNamespace(pf_context *ctx) {
+  return ctx->parent->ns().c_str();
+}
+
+const uint8_t *parentPayload(pf_context *ctx, size_t *length) {
+  if (!ctx->payload) {
+    *length = 0;
+    return nullptr;
+  }
+  *length = ctx->payload->length();
+  return reinterpret_cast<const uint8_t *>(ctx->payload->data());
+}
+
+pf_layer *addLayer(pf_context *ctx, const char *ns, const char *name,
+                   const char *id) {
+  auto layer = std::make_shared<Layer>(str(ns));
+  layer->setName(str(name));
+  layer->setId(str(id));
+  ctx->layers->push_back(layer);
+  return reinterpret_cast<pf_layer *>(layer.get());
+}
+
+void setLayerSummary(pf_context *, pf_layer *layer, const char *summary) {
+  toLayer(layer)->setSummary(str(summary));
+}
+
+void setLayerRange(pf_context *, pf_layer *layer, const char *range) {
+  toLayer(layer)->setRange(str(range));
+}
+
+void setLayerPayload(pf_context *ctx, pf_layer *layer, size_t offset,
+                     size_t length) {
+  toLayer(layer)->setPayload(slice(ctx, offset, length));
+}
+
+pf_item *addItem(pf_context *, pf_layer *layer, pf_item *parent,
+                 const char *name, const char *id, const char *range) {
+  auto item = std::make_shared<Item>();
+  item->setName(str(name));
+  item->setId(str(id));
+  item->setRange(str(range));
+  if (parent) {
+    toItem(parent)->addItem(item);
+  } else if (layer) {
+    toLayer(layer)->addItem(item);
+  } else {
+    return nullptr;
+  }
+  return reinterpret_cast<pf_item *>(item.get());
+}
+
+void setItemSummary(pf_context *, pf_item *item, const char *summary) {
+  toItem(item)->setSummary(str(summary));
+}
+
+void setNumber(pf_context *, pf_item *item, double value) {
+  toItem(item)->setValue(ItemValue(value));
+}
+
+void setBool(pf_context *, pf_item *item, int value) {
+  toItem(item)->setValue(ItemValue(value != 0));
+}
+
+void setString(pf_context *, pf_item *item, const char *value,
+               const char *type) {
+  toItem(item)->setValue(ItemValue(str(value), str(type)));
+}
+
+void setBytes(pf_context *ctx, pf_item *item, size_t offset, size_t length) {
+  toItem(item)->setValue(ItemValue(slice(ctx, offset, length)));
+}
+
+const pf_builder builder = {
+    sizeof(pf_builder),
+    parentNamespace,
+    parentPayload,
+    addLayer,
+    setLayerSummary,
+    setLayerRange,
+    setLayerPayload,
+    addItem,
+    setItemSummary,
+    setNumber,
+    setBool,
+    setString,
+    setBytes,
+};
+
+void *openLibrary(const std::string &path, std::string *error) {
+#ifdef _WIN32
+  HMODULE handle = LoadLibraryA(path.c_str());
+  if (!handle)
+    error->assign(path + ": LoadLibrary failed (" +
+                  std::to_string(GetLastError()) + ")");
+  return reinterpret_cast<void *>(handle);
+#else
+  void *handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle)
+    error->assign(path + ": " + dlerror());
+  return handle;
+#endif
+}
+
+void *findSymbol(void *handle, const char *name) {
+#ifdef _WIN32
+  return reinterpret_cast<void *>(
+      GetProcAddress(reinterpret_cast<HMODULE>(handle), name));
+#else
+  return dlsym(handle, name);
+#endif
+}
+
+void closeLibrary(void *handle) {
+#ifdef _WIN32
+  FreeLibrary(reinterpret_cast<HMODULE>(handle));
+#else
+  dlclose(handle);
+#endif
+}
+}
+
+const NativeDissector *NativeDissector::load(const std::string &path,
+                                             std::string *error) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::unique_ptr<NativeDissector>>
+      plugins;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = plugins.find(path);
+  if (it != plugins.end())
+    return it->second.get();
+
+  void *handle = openLibrary(path, error);
+  if (!handle)
+    return nullptr;
+
+  pf_plugin_entry entry =
+      reinterpret_cast<pf_plugin_entry>(findSymbol(handle, PF_PLUGIN_ENTRY));
+  const pf_plugin *plugin = entry ? entry() : nullptr;
+  if (!plugin) {
+    error->assign(path + ": " PF_PLUGIN_ENTRY " not found");
+    closeLibrary(handle);
+    return nullptr;
+  }
+  if (plugin->abi_version != PF_PLUGIN_ABI_VERSION) {
+    error->assign(path + ": unsupported plugin ABI version " +
+                  std::to_string(plugin->abi_version));
+    closeLibrary(handle);
+    return nullptr;
+  }
+
+  std::unique_ptr<NativeDissector> diss(new NativeDissector());
+  diss->name = str(plugin->name);
+  for (const char *const *ns = plugin->namespaces; ns && *ns; ++ns) {
+    diss->namespaces.push_back(*ns);
+  }
+  diss->analyze = [plugin](
+      const Layer &parent, std::vector<std::shared_ptr<Layer>> *layers,
+      std::vector<std::unique_ptr<StreamChunk>> *) {
+    pf_context ctx;
+    ctx.parent = &parent;
+    ctx.payload = parent.payload();
+    ctx.layers = layers;
+    return plugin->analyze(&ctx, &builder) != 0;
+  };
+
+  const NativeDissector *result = diss.get();
+  plugins[path] = std::move(diss);
+  return result;
+}
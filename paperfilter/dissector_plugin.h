@@ -0,0 +1,85 @@
+#ifndef DISSECTOR_PLUGIN_H
+#define DISSECTOR_PLUGIN_H
+
+/*
+ * C ABI for dissector plugins.
+ *
+ * A plugin is a shared library exporting paperfilter_plugin(), which returns
+ * a descriptor that stays valid while the library is loaded. The host calls
+ * analyze() for every layer whose namespace matches one of the listed
+ * namespaces exactly. It may be called from several dissector threads at
+ * once, so it must not keep per-call state outside of its stack.
+ *
+ * Everything a plugin emits goes through the builder. Handles are only valid
+ * during the analyze() call that returned them. Offsets and lengths refer to
+ * the parent payload and are clamped to it; strings are copied.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#define PF_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define PF_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+#define PF_PLUGIN_ABI_VERSION 1
+#define PF_PLUGIN_ENTRY "paperfilter_plugin"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pf_context pf_context;
+typedef struct pf_layer pf_layer;
+typedef struct pf_item pf_item;
+
+typedef struct pf_builder {
+  /* sizeof(pf_builder) in the host; new functions are only appended. */
+  uint32_t size;
+
+  const char *(*parent_namespace)(pf_context *ctx);
+  const uint8_t *(*parent_payload)(pf_context *ctx, size_t *length);
+
+  pf_layer *(*add_layer)(pf_context *ctx, const char *ns, const char *name,
+                         const char *id);
+  void (*set_layer_summary)(pf_context *ctx, pf_layer *layer,
+                            const char *summary);
+  void (*set_layer_range)(pf_context *ctx, pf_layer *layer,
+                          const char *range);
+  void (*set_layer_payload)(pf_context *ctx, pf_layer *layer, size_t offset,
+                            size_t length);
+
+  /* parent is NULL for a top-level item of layer. */
+  pf_item *(*add_item)(pf_context *ctx, pf_layer *layer, pf_item *parent,
+                       const char *name, const char *id, const char *range);
+  void (*set_item_summary)(pf_context *ctx, pf_item *item,
+                           const char *summary);
+  void (*set_number)(pf_context *ctx, pf_item *item, double value);
+  void (*set_bool)(pf_context *ctx, pf_item *item, int value);
+  /* type names a value type such as "dripcap/mac", or NULL. */
+  void (*set_string)(pf_context *ctx, pf_item *item, const char *value,
+                     const char *type);
+  void (*set_bytes)(pf_context *ctx, pf_item *item, size_t offset,
+                    size_t length);
+} pf_builder;
+
+typedef struct pf_plugin {
+  uint32_t abi_version; /* PF_PLUGIN_ABI_VERSION */
+  const char *name;
+  const char *const *namespaces; /* NULL-terminated */
+
+  /* Returns non-zero if the parent layer was recognized. */
+  int (*analyze)(pf_context *ctx, const pf_builder *builder);
+} pf_plugin;
+
+typedef const pf_plugin *(*pf_plugin_entry)(void);
+
+PF_PLUGIN_EXPORT const pf_plugin *paperfilter_plugin(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
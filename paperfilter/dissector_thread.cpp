@@ -1,12 +1,23 @@
 #include "dissector_thread.hpp"
+#include "atom.hpp"
 #include "packet_dispatcher.hpp"
 #include "log_message.hpp"
+#include "namespace_matcher.hpp"
+#include "native_dissector.hpp"
 #include "console.hpp"
 #include "layer.hpp"
 #include "packet.hpp"
+#include "packet_queue.hpp"
 #include "paper_context.hpp"
+#include "script_cache.hpp"
+#include "startup_snapshot.hpp"
 #include "stream_chunk.hpp"
+#include "work_deque.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
+#include <iterator>
 #include <nan.h>
 #include <thread>
 #include <unordered_set>
@@ -20,6 +31,12 @@
 using namespace v8;
 
 namespace {
+// Results are handed to the store at least this often, so one slow packet
+// does not hold back the ones dissected before it.
+const std::chrono::microseconds batchTime(2000);
+const size_t minBatch = 16;
+const size_t maxBatch = 512;
+
 class ArrayBufferAllocator : public v8::ArrayBuffer::Allocator {
 public:
   ArrayBufferAllocator() {}
@@ -30,44 +47,53 @@ public:
   virtual void Free(void *data, size_t) { free(data); }
 };
 
+const size_t maxCachedNamespaces = 1024;
+
 struct DissectorFunc {
-  std::vector<std::string> namespaces;
-  std::vector<std::regex> regexNamespaces;
   v8::UniquePersistent<v8::Function> func;
 };
+
+struct Matches {
+  std::vector<const NativeDissector *> natives;
+  std::vector<const DissectorFunc *> funcs;
+};
 }
 
 class DissectorThread::Private {
 public:
-  Private(const std::shared_ptr<DissectorSharedContext> &ctx);
+  Private(const std::shared_ptr<DissectorSharedContext> &ctx, size_t index);
   ~Private();
-  const std::vector<const DissectorFunc *> &findDessector(
-      const std::string &ns,
-      const std::unordered_map<std::string, DissectorFunc> &dissectors,
-      std::unordered_map<std::string, std::vector<const DissectorFunc *>>
-          *nsMap);
+  bool steal(std::vector<std::unique_ptr<Packet>> *packets) const;
+  bool stealable() const;
+  const Matches &findDessector(Atom ns,
+                               const std::vector<DissectorFunc> &dissectors,
+                               std::unordered_map<Atom, Matches> *nsMap);
 
 public:
   std::thread thread;
   std::shared_ptr<DissectorSharedContext> ctx;
-  bool closed = false;
+  size_t index;
+  std::atomic<bool> closed;
 };
 
 DissectorThread::Private::Private(
-    const std::shared_ptr<DissectorSharedContext> &ctx)
-    : ctx(ctx) {
+    const std::shared_ptr<DissectorSharedContext> &ctx, size_t index)
+    : ctx(ctx), index(index), closed(false) {
   thread = std::thread([this]() {
     DissectorSharedContext &ctx = *this->ctx;
+    std::shared_ptr<const StartupSnapshot> snapshot;
+    if (ctx.startupSnapshot)
+      snapshot = StartupSnapshot::get(ctx.dissectors);
     v8::Isolate::CreateParams create_params;
     create_params.array_buffer_allocator = new ArrayBufferAllocator();
+    if (snapshot)
+      create_params.snapshot_blob = snapshot->blob();
     v8::Isolate *isolate = v8::Isolate::New(create_params);
 
     // workaround for chromium task runner
     char dummyData[128] = {0};
     isolate->SetData(0, dummyData);
 
-    static const int dissectorQuota = 512;
-
     {
       std::unique_ptr<v8::Locker> locker;
       v8::Isolate::Scope isolate_scope(isolate);
@@ -83,19 +109,26 @@ DissectorThread::Private::Private(
           v8pp::class_<Console>::create_object(isolate, ctx.logCb, "dissector");
       ppctx.set("console", console);
 
-      std::unordered_map<std::string, DissectorFunc> dissectors;
-      std::unordered_map<std::string, std::vector<const DissectorFunc *>> nsMap;
+      std::vector<DissectorFunc> dissectors(ctx.dissectors.size());
+      std::vector<NamespaceMatcher::Pattern> patterns(ctx.dissectors.size());
+      std::unordered_map<Atom, Matches> nsMap;
 
-      for (const Dissector &diss : ctx.dissectors) {
+      for (size_t i = 0; i < ctx.dissectors.size(); ++i) {
+        const Dissector &diss = ctx.dissectors[i];
         v8::Local<v8::Object> moduleObj = v8::Object::New(isolate);
         ppctx.set("module", moduleObj);
 
         v8::Local<v8::Function> func;
-        Nan::MaybeLocal<Nan::BoundScript> script = Nan::CompileScript(
-            v8pp::to_v8(isolate, "(function(){" + diss.script + "})()"),
-            v8::ScriptOrigin(v8pp::to_v8(isolate, diss.resourceName)));
-        if (!script.IsEmpty()) {
-          Nan::RunScript(script.ToLocalChecked());
+        bool loaded = snapshot && snapshot->run(isolate, i);
+        if (!loaded) {
+          v8::MaybeLocal<v8::Script> script = ScriptCache::instance().compile(
+              isolate, "(function(){" + diss.script + "})()",
+              diss.resourceName);
+          // A script that throws is reported through try_catch below.
+          loaded = !script.IsEmpty() &&
+                   !Nan::RunScript(script.ToLocalChecked()).IsEmpty();
+        }
+        if (loaded) {
           v8::Local<v8::Value> result =
               moduleObj->Get(v8::String::NewFromUtf8(isolate, "exports"));
 
@@ -121,18 +154,17 @@ DissectorThread::Private::Private(
           }
         } else {
           v8::Local<v8::Array> namespaces;
-          std::vector<std::string> stringNamespaces;
-          std::vector<std::regex> regexNamespaces;
+          NamespaceMatcher::Pattern &pattern = patterns[i];
 
           if (v8pp::get_option(isolate, func, "namespaces", namespaces)) {
-            for (uint32_t i = 0; i < namespaces->Length(); ++i) {
-              v8::Local<v8::Value> ns = namespaces->Get(i);
+            for (uint32_t j = 0; j < namespaces->Length(); ++j) {
+              v8::Local<v8::Value> ns = namespaces->Get(j);
               if (ns->IsString()) {
-                stringNamespaces.push_back(
+                pattern.strings.push_back(
                     v8pp::from_v8<std::string>(isolate, ns, ""));
               } else if (ns->IsRegExp()) {
-                regexNamespaces.push_back(std::regex(v8pp::from_v8<std::string>(
-                    isolate, ns.As<v8::RegExp>()->GetSource(), "")));
+                pattern.regexes.push_back(v8pp::from_v8<std::string>(
+                    isolate, ns.As<v8::RegExp>()->GetSource(), ""));
               }
             }
           }
@@ -150,14 +182,24 @@ DissectorThread::Private::Private(
                 obj->Get(v8pp::to_v8(isolate, "analyze"));
             if (!analyze.IsEmpty() && analyze->IsFunction()) {
               v8::Local<v8::Function> analyzeFunc = analyze.As<v8::Function>();
-              dissectors[diss.resourceName] = {
-                  stringNamespaces, regexNamespaces,
-                  v8::UniquePersistent<v8::Function>(isolate, analyzeFunc)};
+              dissectors[i].func.Reset(isolate, analyzeFunc);
             }
           }
         }
       }
 
+      // Every thread derives the same patterns; the first one to get here
+      // compiles them for the whole session. Native dissectors follow the
+      // scripts.
+      for (const NativeDissector *native : ctx.nativeDissectors) {
+        NamespaceMatcher::Pattern pattern;
+        pattern.strings = native->namespaces;
+        patterns.push_back(pattern);
+      }
+      std::call_once(ctx.matcherFlag, [&ctx, &patterns]() {
+        ctx.matcher = std::make_shared<NamespaceMatcher>(patterns);
+      });
+
       v8::Local<v8::String> profTitle = v8pp::to_v8(isolate, "diss");
       v8::CpuProfiler *prof = nullptr;
       const char *profFlag = std::getenv("PAPERFILTER_PROFILE");
@@ -168,39 +210,91 @@ DissectorThread::Private::Private(
         prof->StartProfiling(profTitle, true);
       }
 
-      while (true) {
-        std::unique_lock<std::mutex> lock(ctx.mutex);
-        ctx.cond.wait(lock,
-                      [this, &ctx] { return !ctx.queue.empty() || closed; });
-        if (closed)
-          break;
-
-        std::vector<std::shared_ptr<Packet>> packets;
-        for (int i = 0; i < dissectorQuota && !ctx.queue.empty(); ++i) {
-          packets.push_back(std::move(ctx.queue.front()));
-          ctx.queue.pop();
+      WorkDeque &local = *ctx.deques[index];
+      PacketQueue &inbox = *ctx.inboxes[index];
+      std::vector<std::unique_ptr<Packet>> incoming;
+      std::vector<std::shared_ptr<Packet>> packets;
+      std::chrono::steady_clock::time_point batchStart;
+      double cost = 0; // moving average per packet, in microseconds
+      size_t batchSize = maxBatch;
+
+      auto flush = [&ctx, &packets]() {
+        if (!packets.empty() && ctx.packetCb)
+          ctx.packetCb(packets);
+        packets.clear();
+      };
+
+      while (!closed) {
+        std::unique_ptr<Packet> next;
+        if (!local.pop(&next)) {
+          flush();
+          incoming.clear();
+          if (inbox.tryPop(&incoming, batchSize) == 0 &&
+              ctx.queue.tryPop(&incoming, batchSize) == 0 &&
+              !steal(&incoming)) {
+            if (ctx.flowAffinity) {
+              inbox.pop(&incoming, batchSize, [this, &ctx] {
+                return closed || ctx.queue.size() > 0 || stealable();
+              });
+            } else {
+              ctx.queue.pop(&incoming, batchSize, [this, &inbox] {
+                return closed || inbox.size() > 0 || stealable();
+              });
+            }
+          }
+          if (incoming.size() > 1 && !ctx.flowAffinity) {
+            // Let a parked thread take a share of the new work.
+            local.push(&incoming);
+            ctx.queue.wake(1);
+          } else if (!incoming.empty()) {
+            local.push(&incoming);
+          }
+          continue;
         }
-        lock.unlock();
 
-        for (std::shared_ptr<Packet> &pkt : packets) {
+        std::shared_ptr<Packet> pkt(std::move(next));
+        const auto start = std::chrono::steady_clock::now();
+        if (packets.empty())
+          batchStart = start;
+
+        {
           v8::Local<v8::Object> packetObj =
               v8pp::class_<Packet>::reference_external(isolate, pkt.get());
 
-          std::unordered_map<std::string, std::shared_ptr<Layer>> layers =
+          std::unordered_map<Atom, std::shared_ptr<Layer>> layers =
               pkt->layers();
 
-          std::unordered_set<std::string> usedNs;
+          std::unordered_set<Atom> usedNs;
           std::vector<std::unique_ptr<StreamChunk>> streams;
 
           while (!layers.empty()) {
-            std::unordered_map<std::string, std::shared_ptr<Layer>> nextLayers;
+            std::unordered_map<Atom, std::shared_ptr<Layer>> nextLayers;
 
             for (const auto &pair : layers) {
               usedNs.insert(pair.first);
               pair.second->setPacket(pkt);
 
-              for (const DissectorFunc *diss :
-                   findDessector(pair.first, dissectors, &nsMap)) {
+              const Matches &matches =
+                  findDessector(pair.first, dissectors, &nsMap);
+
+              // Native dissectors do not enter V8; their layers are
+              // dissected further in the next round like any other. Output
+              // of a dissector that rejects the layer is discarded.
+              for (const NativeDissector *native : matches.natives) {
+                std::vector<std::shared_ptr<Layer>> childLayers;
+                std::vector<std::unique_ptr<StreamChunk>> childStreams;
+                if (!native->analyze(*pair.second, &childLayers,
+                                     &childStreams))
+                  continue;
+                std::move(childStreams.begin(), childStreams.end(),
+                          std::back_inserter(streams));
+                for (const auto &child : childLayers) {
+                  nextLayers[child->nsAtom()] = child;
+                  pair.second->layers()[child->nsAtom()] = child;
+                }
+              }
+
+              for (const DissectorFunc *diss : matches.funcs) {
 
                 v8::Local<v8::Function> analyzeFunc =
                     v8::Local<v8::Function>::New(isolate, diss->func);
@@ -253,13 +347,13 @@ DissectorThread::Private::Private(
                 }
 
                 for (const auto &child : childLayers) {
-                  nextLayers[child->ns()] = child;
-                  pair.second->layers()[child->ns()] = child;
+                  nextLayers[child->nsAtom()] = child;
+                  pair.second->layers()[child->nsAtom()] = child;
                 }
               }
             }
 
-            for (const std::string &ns : usedNs) {
+            for (Atom ns : usedNs) {
               nextLayers.erase(ns);
             }
             nextLayers.swap(layers);
@@ -271,10 +365,19 @@ DissectorThread::Private::Private(
             ctx.streamsCb(pkt->seq(), std::move(streams));
         }
 
-        if (ctx.packetCb)
-          ctx.packetCb(packets);
-
-        lock.lock();
+        // Cheap packets go out in large batches, expensive ones in small
+        // batches so the store sees them without waiting for a full quota.
+        const auto end = std::chrono::steady_clock::now();
+        const double elapsed =
+            std::chrono::duration<double, std::micro>(end - start).count();
+        cost = cost > 0 ? cost * 0.9 + elapsed * 0.1 : elapsed;
+        batchSize = std::max(
+            minBatch, std::min(maxBatch, static_cast<size_t>(
+                                             batchTime.count() / (cost + 1))));
+
+        packets.push_back(std::move(pkt));
+        if (packets.size() >= batchSize || end - batchStart >= batchTime)
+          flush();
       }
 
       if (prof) {
@@ -305,51 +408,72 @@ DissectorThread::Private::Private(
 }
 
 DissectorThread::Private::~Private() {
-  {
-    std::lock_guard<std::mutex> lock(ctx->mutex);
-    closed = true;
-  }
-  ctx->cond.notify_all();
+  closed = true;
+  ctx->queue.wakeAll();
+  ctx->inboxes[index]->wakeAll();
   if (thread.joinable())
     thread.join();
 }
 
-const std::vector<const DissectorFunc *> &
-DissectorThread::Private::findDessector(
-    const std::string &ns,
-    const std::unordered_map<std::string, DissectorFunc> &dissectors,
-    std::unordered_map<std::string, std::vector<const DissectorFunc *>>
-        *nsMap) {
-  static const std::vector<DissectorFunc *> null;
+bool DissectorThread::Private::steal(
+    std::vector<std::unique_ptr<Packet>> *packets) const {
+  const size_t threads = ctx->deques.size();
+  for (size_t i = 1; i < threads; ++i) {
+    const size_t victim = (index + i) % threads;
+    if (ctx->flowAffinity) {
+      // Taking from a peer's inbox breaks affinity, so it is only done for
+      // a backlog.
+      PacketQueue &inbox = *ctx->inboxes[victim];
+      if (inbox.size() > DissectorSharedContext::inboxBacklog &&
+          inbox.tryPop(packets, maxBatch) > 0)
+        return true;
+    } else if (ctx->deques[victim]->steal(packets) > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool DissectorThread::Private::stealable() const {
+  for (size_t i = 0; i < ctx->deques.size(); ++i) {
+    if (i == index)
+      continue;
+    if (ctx->flowAffinity) {
+      if (ctx->inboxes[i]->size() > DissectorSharedContext::inboxBacklog)
+        return true;
+    } else if (ctx->deques[i]->size() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
 
+const Matches &DissectorThread::Private::findDessector(
+    Atom ns, const std::vector<DissectorFunc> &dissectors,
+    std::unordered_map<Atom, Matches> *nsMap) {
   auto it = nsMap->find(ns);
   if (it != nsMap->end())
     return it->second;
 
-  std::vector<const DissectorFunc *> &funcs = (*nsMap)[ns];
-  for (const auto &pair : dissectors) {
-    const auto &diss = pair.second;
-    for (const std::string &dissNs : diss.namespaces) {
-      if (dissNs == ns) {
-        funcs.push_back(&diss);
-        break;
-      }
-    }
-    if (funcs.empty()) {
-      for (const std::regex &regex : diss.regexNamespaces) {
-        if (std::regex_match(ns, regex)) {
-          funcs.push_back(&diss);
-          break;
-        }
-      }
+  // The shared matcher has its own cache; this one only saves the lock.
+  if (nsMap->size() >= maxCachedNamespaces)
+    nsMap->clear();
+
+  Matches &matches = (*nsMap)[ns];
+  for (size_t index : *ctx->matcher->match(ns.str())) {
+    if (index < dissectors.size()) {
+      if (!dissectors[index].func.IsEmpty())
+        matches.funcs.push_back(&dissectors[index]);
+    } else if (index - dissectors.size() < ctx->nativeDissectors.size()) {
+      matches.natives.push_back(
+          ctx->nativeDissectors[index - dissectors.size()]);
     }
   }
-
-  return funcs;
+  return matches;
 }
 
 DissectorThread::DissectorThread(
-    const std::shared_ptr<DissectorSharedContext> &ctx)
-    : d(new Private(ctx)) {}
+    const std::shared_ptr<DissectorSharedContext> &ctx, size_t index)
+    : d(new Private(ctx, index)) {}
 
 DissectorThread::~DissectorThread() {}
@@ -291,7 +291,8 @@ FilterFunc makeFilter(const json11::Json &json) {
     });
   } else if (type == "Identifier") {
     const std::string &name = json["name"].string_value();
-    return FilterFunc([isolate, name](Packet *pkt) {
+    const Atom id(name);
+    return FilterFunc([isolate, name, id](Packet *pkt) {
 
       v8::Local<v8::Value> key = v8pp::to_v8(isolate, name);
       v8::Local<v8::Object> pktObject =
@@ -304,29 +305,26 @@ FilterFunc makeFilter(const json11::Json &json) {
       }
 
       std::function<std::shared_ptr<Layer>(
-          const std::string &name,
-          const std::unordered_map<std::string, std::shared_ptr<Layer>> &)>
+          Atom id, const std::unordered_map<Atom, std::shared_ptr<Layer>> &)>
           findLayer;
       findLayer = [&findLayer](
-          const std::string &name,
-          const std::unordered_map<std::string, std::shared_ptr<Layer>>
-              &layers) {
+          Atom id,
+          const std::unordered_map<Atom, std::shared_ptr<Layer>> &layers) {
         for (const auto &pair : layers) {
-          if (pair.second->id() == name) {
+          if (pair.second->idAtom() == id) {
             return pair.second;
           }
         }
         for (const auto &pair : layers) {
           const std::shared_ptr<Layer> &layer =
-              findLayer(name, pair.second->layers());
+              findLayer(id, pair.second->layers());
           if (layer) {
             return layer;
           }
         }
         return std::shared_ptr<Layer>();
       };
-      if (const std::shared_ptr<Layer> &layer =
-              findLayer(name, pkt->layers())) {
+      if (const std::shared_ptr<Layer> &layer = findLayer(id, pkt->layers())) {
         v8::Local<v8::Object> layerObject =
             v8pp::class_<Layer>::find_object(isolate, layer.get());
         if (!layerObject.IsEmpty()) {
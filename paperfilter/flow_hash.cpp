@@ -0,0 +1,80 @@
+#include "flow_hash.hpp"
+#include <cstring>
+
+namespace {
+uint16_t load16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+
+// FNV-1a
+uint32_t mix(uint32_t hash, const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+}
+
+namespace FlowHash {
+bool hash(const uint8_t *data, size_t length, uint32_t *value) {
+  if (length < 14)
+    return false;
+  size_t offset = 14;
+  uint16_t type = load16(data + 12);
+  while ((type == 0x8100 || type == 0x88a8) && length >= offset + 4) {
+    type = load16(data + offset + 2);
+    offset += 4;
+  }
+
+  const uint8_t *ip = data + offset;
+  const uint8_t *addrs[2];
+  size_t addrLength = 0;
+  const uint8_t *transport = nullptr;
+  uint8_t protocol = 0;
+
+  if (type == 0x0800 && length >= offset + 20) {
+    size_t ihl = (ip[0] & 0x0f) * 4;
+    if (ihl < 20 || length < offset + ihl)
+      return false;
+    addrs[0] = ip + 12;
+    addrs[1] = ip + 16;
+    addrLength = 4;
+    protocol = ip[9];
+    // Every fragment is hashed without ports so they all stay together.
+    if ((load16(ip + 6) & 0x3fff) == 0)
+      transport = ip + ihl;
+  } else if (type == 0x86dd && length >= offset + 40) {
+    addrs[0] = ip + 8;
+    addrs[1] = ip + 24;
+    addrLength = 16;
+    protocol = ip[6];
+    transport = ip + 40;
+  } else {
+    return false;
+  }
+
+  uint16_t ports[2] = {0, 0};
+  if (transport && (protocol == 6 || protocol == 17 || protocol == 132) &&
+      length >= static_cast<size_t>(transport - data) + 4) {
+    ports[0] = load16(transport);
+    ports[1] = load16(transport + 2);
+  }
+
+  // Order the endpoints so that the reply direction hashes the same.
+  int cmp = memcmp(addrs[0], addrs[1], addrLength);
+  int first = (cmp < 0 || (cmp == 0 && ports[0] <= ports[1])) ? 0 : 1;
+  int second = 1 - first;
+
+  uint32_t h = 2166136261u;
+  h = mix(h, &protocol, 1);
+  h = mix(h, addrs[first], addrLength);
+  h = mix(h, addrs[second], addrLength);
+  const uint8_t portBytes[4] = {
+      static_cast<uint8_t>(ports[first] >> 8),
+      static_cast<uint8_t>(ports[first] & 0xff),
+      static_cast<uint8_t>(ports[second] >> 8),
+      static_cast<uint8_t>(ports[second] & 0xff)};
+  h = mix(h, portBytes, sizeof(portBytes));
+  *value = h;
+  return true;
+}
+}
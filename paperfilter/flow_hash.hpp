@@ -0,0 +1,13 @@
+#ifndef FLOW_HASH_HPP
+#define FLOW_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FlowHash {
+// Hashes the IP 5-tuple of an Ethernet frame. Both directions of a flow give
+// the same value. Returns false when there is no IPv4 or IPv6 header to hash.
+bool hash(const uint8_t *data, size_t length, uint32_t *value);
+}
+
+#endif
@@ -57,6 +57,19 @@ class Session extends EventEmitter {
     this._sess.statusCallback = (stat) => {
       this.emit('status', stat);
     };
+    this._exports = new Map();
+    this._sess.exportCallback = (progress) => {
+      this.emit('export', progress);
+      const pending = this._exports.get(progress.path);
+      if (progress.done && pending) {
+        this._exports.delete(progress.path);
+        if (progress.error) {
+          pending.reject(new Error(progress.error));
+        } else {
+          pending.resolve(progress);
+        }
+      }
+    };
     this._reset = _.debounce(() => {
       this._sess.reset(this._option);
     }, 100);
@@ -67,6 +80,8 @@ class Session extends EventEmitter {
       namespace: option.namespace,
       dissectors: [],
       stream_dissectors: [],
+      native_dissectors: [],
+      dissector_plugins: [],
       config: option.config
     };
     let errors = [];
@@ -95,6 +110,18 @@ class Session extends EventEmitter {
         }));
       }
     }
+    if (Array.isArray(option.native_dissectors)) {
+      sessOption.native_dissectors = option.native_dissectors.slice();
+    }
+    if (option.startup_snapshot) {
+      sessOption.startup_snapshot = true;
+    }
+    if (typeof option.code_cache === 'string') {
+      sessOption.code_cache = option.code_cache;
+    }
+    if (Array.isArray(option.dissector_plugins)) {
+      sessOption.dissector_plugins = option.dissector_plugins.slice();
+    }
     return Promise.all(tasks).then(() => {
       return new Session(sessOption, errors);
     });
@@ -104,6 +131,37 @@ class Session extends EventEmitter {
     return this._sess.analyze(pkt);
   }
 
+  analyzeBuffer(buffer, table) {
+    return this._sess.analyzeBuffer(buffer, table);
+  }
+
+  analyzeRaw(buffer, options = {}) {
+    return this._sess.analyzeRaw(buffer, options);
+  }
+
+  load(path) {
+    return this._sess.load(path);
+  }
+
+  replay(path, options = {}) {
+    return this._sess.replay(path, options);
+  }
+
+  stopReplay() {
+    return this._sess.stopReplay();
+  }
+
+  get replayStatus() {
+    return this._sess.replayStatus;
+  }
+
+  export(path, options = {}) {
+    return new Promise((resolve, reject) => {
+      this._sess.export(path, options);
+      this._exports.set(path, {resolve, reject});
+    });
+  }
+
   filter(name, filter) {
     let body = '';
     const ast = esprima.parse(filter);
@@ -171,6 +229,14 @@ class Session extends EventEmitter {
     this._sess.interface = ifs;
   }
 
+  get interfaces() {
+    return this._sess.interfaces;
+  }
+
+  set interfaces(list) {
+    this._sess.interfaces = list;
+  }
+
   get promiscuous() {
     return this._sess.promiscuous;
   }
@@ -187,6 +253,22 @@ class Session extends EventEmitter {
     this._sess.snaplen = len;
   }
 
+  get captureOptions() {
+    return this._sess.captureOptions;
+  }
+
+  set captureOptions(options) {
+    this._sess.captureOptions = options;
+  }
+
+  get captureFile() {
+    return this._sess.captureFile;
+  }
+
+  set captureFile(options) {
+    this._sess.captureFile = options;
+  }
+
   setBPF(bpf) {
     this._sess.setBPF(bpf);
   }
@@ -244,6 +326,16 @@ class Session extends EventEmitter {
     });
   }
 
+  registerNativeDissector(name) {
+    this.unregisterNativeDissector(name);
+    this._option.native_dissectors.push(name);
+  }
+
+  registerDissectorPlugin(path) {
+    this.unregisterDissectorPlugin(path);
+    this._option.dissector_plugins.push(path);
+  }
+
   unregisterDissector(script) {
     let list = [];
     for (let item of this._option.dissectors) {
@@ -265,6 +357,18 @@ class Session extends EventEmitter {
     this._option.stream_dissectors = list;
     this._reset();
   }
+
+  unregisterNativeDissector(name) {
+    this._option.native_dissectors =
+      this._option.native_dissectors.filter(e => e !== name);
+    this._reset();
+  }
+
+  unregisterDissectorPlugin(path) {
+    this._option.dissector_plugins =
+      this._option.dissector_plugins.filter(e => e !== path);
+    this._reset();
+  }
 }
 
 module.exports = {
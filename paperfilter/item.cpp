@@ -7,6 +7,9 @@
 using namespace v8;
 
 class Item::Private {
+public:
+  void indexItem();
+
 public:
   std::string name;
   std::string id;
@@ -14,9 +17,16 @@ public:
   std::string summary;
   ItemValue value;
   std::vector<std::shared_ptr<Item>> items;
-  std::map<std::string, size_t> keys;
+  std::unordered_map<std::string, size_t> keys;
 };
 
+// Items without an id are only reachable through items().
+void Item::Private::indexItem() {
+  const std::string &id = items.back()->id();
+  if (!id.empty())
+    keys[id] = items.size() - 1;
+}
+
 Item::Item() : d(new Private()) {}
 
 Item::Item(const v8::FunctionCallbackInfo<v8::Value> &args) : Item(args[0]) {}
@@ -55,11 +65,11 @@ Item::Item(v8::Local<v8::Value> value) : d(new Private()) {
 
 Item::~Item() {}
 
-std::string Item::name() const { return d->name; }
+const std::string &Item::name() const { return d->name; }
 
 void Item::setName(const std::string &name) { d->name = name; }
 
-std::string Item::id() const { return d->id; }
+const std::string &Item::id() const { return d->id; }
 
 void Item::setId(const std::string &id) { d->id = id; }
 
@@ -86,6 +96,8 @@ void Item::setValue(v8::Local<v8::Object> value) {
   }
 }
 
+void Item::setValue(const ItemValue &value) { d->value = value; }
+
 std::vector<std::shared_ptr<Item>> Item::items() const { return d->items; }
 
 void Item::addItem(v8::Local<v8::Object> obj) {
@@ -97,7 +109,12 @@ void Item::addItem(v8::Local<v8::Object> obj) {
   } else {
     return;
   }
-  d->keys[d->items.back()->id()] = d->items.size() - 1;
+  d->indexItem();
+}
+
+void Item::addItem(const std::shared_ptr<Item> &item) {
+  d->items.push_back(item);
+  d->indexItem();
 }
 
 std::shared_ptr<Item> Item::item(const std::string &id) const {
@@ -16,9 +16,9 @@ public:
   Item(const Item &item);
   ~Item();
 
-  std::string name() const;
+  const std::string &name() const;
   void setName(const std::string &name);
-  std::string id() const;
+  const std::string &id() const;
   void setId(const std::string &id);
   std::string range() const;
   void setRange(const std::string &range);
@@ -27,9 +27,11 @@ public:
   v8::Local<v8::Object> valueObject() const;
   ItemValue value() const;
   void setValue(v8::Local<v8::Object> value);
+  void setValue(const ItemValue &value);
 
   std::vector<std::shared_ptr<Item>> items() const;
   void addItem(v8::Local<v8::Object> obj);
+  void addItem(const std::shared_ptr<Item> &item);
   std::shared_ptr<Item> item(const std::string &id) const;
   v8::Local<v8::Object> itemObject(const std::string &id) const;
 
@@ -58,6 +58,31 @@ ItemValue::ItemValue(v8::Local<v8::Value> val) : ItemValue() {
   }
 }
 
+ItemValue::ItemValue(double num) : ItemValue() {
+  d->num = num;
+  d->base = NUMBER;
+}
+
+ItemValue::ItemValue(bool value) : ItemValue() {
+  d->num = value;
+  d->base = BOOLEAN;
+}
+
+ItemValue::ItemValue(const std::string &str, const std::string &type)
+    : ItemValue() {
+  d->str = str;
+  d->type = type;
+  d->base = STRING;
+}
+
+ItemValue::ItemValue(std::unique_ptr<Buffer> buffer) : ItemValue() {
+  if (buffer) {
+    d->buf = std::move(buffer);
+    d->buf->freeze();
+    d->base = BUFFER;
+  }
+}
+
 ItemValue::ItemValue(const ItemValue &value) : ItemValue() { *this = value; }
 
 ItemValue &ItemValue::operator=(const ItemValue &other) {
@@ -127,3 +152,5 @@ v8::Local<v8::Value> ItemValue::data() const {
 }
 
 std::string ItemValue::type() const { return d->type; }
+
+std::string ItemValue::str() const { return d->str; }
@@ -24,11 +24,16 @@ public:
   ItemValue();
   explicit ItemValue(const v8::FunctionCallbackInfo<v8::Value> &args);
   explicit ItemValue(v8::Local<v8::Value> val);
+  explicit ItemValue(double num);
+  explicit ItemValue(bool value);
+  ItemValue(const std::string &str, const std::string &type);
+  explicit ItemValue(std::unique_ptr<Buffer> buffer);
   ItemValue(const ItemValue &value);
   ItemValue &operator=(const ItemValue &);
   ~ItemValue();
   v8::Local<v8::Value> data() const;
   std::string type() const;
+  std::string str() const;
 
 private:
   class Private;
@@ -9,29 +9,43 @@ using namespace v8;
 
 class Layer::Private {
 public:
-  std::string ns;
+  void indexItem();
+
+public:
+  Atom ns;
   std::string name;
-  std::string id;
+  Atom id;
   std::string summary;
   std::string range;
   double confidence = 1.0;
-  std::unordered_map<std::string, std::shared_ptr<Layer>> layers;
+  std::unordered_map<Atom, std::shared_ptr<Layer>> layers;
   std::weak_ptr<Packet> pkt;
   std::vector<std::shared_ptr<Item>> items;
-  std::map<std::string, size_t> keys;
+  std::unordered_map<std::string, size_t> keys;
   std::unique_ptr<Buffer> payload;
   std::unique_ptr<LargeBuffer> largePayload;
 };
 
+// Items without an id are only reachable through items().
+void Layer::Private::indexItem() {
+  const std::string &id = items.back()->id();
+  if (!id.empty())
+    keys[id] = items.size() - 1;
+}
+
 Layer::Layer(const std::string &ns) : d(std::make_shared<Private>()) {
-  d->ns = ns;
+  d->ns = Atom(ns);
 }
 
 Layer::Layer(v8::Local<v8::Object> options) : d(std::make_shared<Private>()) {
   v8::Isolate *isolate = v8::Isolate::GetCurrent();
-  v8pp::get_option(isolate, options, "namespace", d->ns);
+  std::string ns;
+  std::string id;
+  if (v8pp::get_option(isolate, options, "namespace", ns))
+    d->ns = Atom(ns);
   v8pp::get_option(isolate, options, "name", d->name);
-  v8pp::get_option(isolate, options, "id", d->id);
+  if (v8pp::get_option(isolate, options, "id", id))
+    d->id = Atom(id);
   v8pp::get_option(isolate, options, "summary", d->summary);
   v8pp::get_option(isolate, options, "range", d->range);
   v8pp::get_option(isolate, options, "confidence", d->confidence);
@@ -61,17 +75,21 @@ Layer::Layer(v8::Local<v8::Object> options) : d(std::make_shared<Private>()) {
 
 Layer::~Layer() {}
 
-std::string Layer::ns() const { return d->ns; }
+const std::string &Layer::ns() const { return d->ns.str(); }
+
+Atom Layer::nsAtom() const { return d->ns; }
 
-void Layer::setNs(const std::string &ns) { d->ns = ns; }
+void Layer::setNs(const std::string &ns) { d->ns = Atom(ns); }
 
-std::string Layer::name() const { return d->name; }
+const std::string &Layer::name() const { return d->name; }
 
 void Layer::setName(const std::string &name) { d->name = name; }
 
-std::string Layer::id() const { return d->id; }
+const std::string &Layer::id() const { return d->id.str(); }
 
-void Layer::setId(const std::string &id) { d->id = id; }
+Atom Layer::idAtom() const { return d->id; }
+
+void Layer::setId(const std::string &id) { d->id = Atom(id); }
 
 std::string Layer::summary() const { return d->summary; };
 
@@ -86,10 +104,10 @@ double Layer::confidence() const { return d->confidence; }
 void Layer::setConfidence(double confidence) { d->confidence = confidence; }
 
 void Layer::addLayer(const std::shared_ptr<Layer> &layer) {
-  d->layers[layer->ns()] = std::move(layer);
+  d->layers[layer->nsAtom()] = std::move(layer);
 }
 
-std::unordered_map<std::string, std::shared_ptr<Layer>> &Layer::layers() const {
+std::unordered_map<Atom, std::shared_ptr<Layer>> &Layer::layers() const {
   return d->layers;
 }
 
@@ -98,7 +116,7 @@ v8::Local<v8::Object> Layer::layersObject() const {
   v8::Local<v8::Object> obj = v8::Object::New(isolate);
   for (const auto &pair : d->layers) {
     obj->Set(
-        v8pp::to_v8(isolate, pair.first),
+        v8pp::to_v8(isolate, pair.first.str()),
         v8pp::class_<Layer>::reference_external(isolate, pair.second.get()));
   }
   return obj;
@@ -117,7 +135,12 @@ void Layer::addItem(v8::Local<v8::Object> obj) {
   } else {
     return;
   }
-  d->keys[d->items.back()->id()] = d->items.size() - 1;
+  d->indexItem();
+}
+
+void Layer::addItem(const std::shared_ptr<Item> &item) {
+  d->items.push_back(item);
+  d->indexItem();
 }
 
 std::vector<std::shared_ptr<Item>> Layer::items() const { return d->items; }
@@ -1,6 +1,7 @@
 #ifndef LAYER_HPP
 #define LAYER_HPP
 
+#include "atom.hpp"
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -20,11 +21,13 @@ public:
   ~Layer();
   Layer &operator=(const Layer &) = delete;
 
-  std::string ns() const;
+  const std::string &ns() const;
+  Atom nsAtom() const;
   void setNs(const std::string &ns);
-  std::string name() const;
+  const std::string &name() const;
   void setName(const std::string &name);
-  std::string id() const;
+  const std::string &id() const;
+  Atom idAtom() const;
   void setId(const std::string &name);
   std::string summary() const;
   void setSummary(const std::string &summary);
@@ -34,13 +37,14 @@ public:
   void setConfidence(double confidence);
 
   void addLayer(const std::shared_ptr<Layer> &layer);
-  std::unordered_map<std::string, std::shared_ptr<Layer>> &layers() const;
+  std::unordered_map<Atom, std::shared_ptr<Layer>> &layers() const;
   v8::Local<v8::Object> layersObject() const;
 
   void setPacket(const std::shared_ptr<Packet> &pkt);
   std::shared_ptr<Packet> packet() const;
 
   void addItem(v8::Local<v8::Object> obj);
+  void addItem(const std::shared_ptr<Item> &item);
   std::vector<std::shared_ptr<Item>> items() const;
   std::shared_ptr<Item> item(const std::string &id) const;
   v8::Local<v8::Object> itemObject(const std::string &id) const;
@@ -0,0 +1,251 @@
+#include "device_registry.hpp"
+#include <cerrno>
+#include <fstream>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <mutex>
+#include <pcap.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+struct Entry {
+  int ifindex;
+  Pcap::Device dev;
+};
+
+// Mirrors the non-cooked mapping libpcap uses on Linux. Anything else is
+// left to probeLinkType().
+int linkTypeFromArphrd(int type) {
+  switch (type) {
+  case ARPHRD_ETHER:
+  case ARPHRD_LOOPBACK:
+    return DLT_EN10MB;
+  case ARPHRD_NONE:
+    return DLT_RAW;
+  case ARPHRD_PPP:
+    return DLT_LINUX_SLL;
+  case ARPHRD_IEEE80211:
+    return DLT_IEEE802_11;
+  case ARPHRD_IEEE80211_PRISM:
+    return DLT_PRISM_HEADER;
+  case ARPHRD_IEEE80211_RADIOTAP:
+    return DLT_IEEE802_11_RADIO;
+  default:
+    return -1;
+  }
+}
+
+int probeLinkType(const std::string &name) {
+  char err[PCAP_ERRBUF_SIZE] = {'\0'};
+  pcap_t *pcap = pcap_open_live(name.c_str(), 1600, false, 0, err);
+  if (!pcap)
+    return -1;
+  int link = pcap_datalink(pcap);
+  pcap_close(pcap);
+  return link;
+}
+
+int linkType(const std::string &name, int arphrd) {
+  int link = linkTypeFromArphrd(arphrd);
+  return link >= 0 ? link : probeLinkType(name);
+}
+
+int sysfsArphrd(const std::string &name) {
+  std::ifstream ifs("/sys/class/net/" + name + "/type");
+  int type = -1;
+  if (!(ifs >> type))
+    return -1;
+  return type;
+}
+}
+
+class DeviceRegistry::Private {
+public:
+  Private();
+  ~Private();
+  void enumerate();
+  void listen();
+  void update(const nlmsghdr *nh);
+
+public:
+  mutable std::mutex mutex;
+  std::vector<Entry> entries;
+  std::thread thread;
+  int netlinkFd = -1;
+  int wakeFd = -1;
+};
+
+DeviceRegistry::Private::Private() {
+  netlinkFd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+  if (netlinkFd >= 0) {
+    sockaddr_nl addr = {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK;
+    if (bind(netlinkFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) <
+        0) {
+      close(netlinkFd);
+      netlinkFd = -1;
+    }
+  }
+
+  // Subscribe before the initial scan so that no change slips in between.
+  enumerate();
+
+  if (netlinkFd >= 0) {
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    thread = std::thread(&Private::listen, this);
+  }
+}
+
+DeviceRegistry::Private::~Private() {
+  if (wakeFd >= 0)
+    eventfd_write(wakeFd, 1);
+  if (thread.joinable())
+    thread.join();
+  if (netlinkFd >= 0)
+    close(netlinkFd);
+  if (wakeFd >= 0)
+    close(wakeFd);
+}
+
+void DeviceRegistry::Private::enumerate() {
+  std::vector<Entry> list;
+
+  pcap_if_t *alldevsp;
+  char err[PCAP_ERRBUF_SIZE] = {'\0'};
+  if (pcap_findalldevs(&alldevsp, err) < 0) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    return;
+  }
+
+  for (pcap_if_t *ifs = alldevsp; ifs; ifs = ifs->next) {
+    Entry entry;
+    entry.ifindex = if_nametoindex(ifs->name);
+    entry.dev.id = ifs->name;
+    entry.dev.name = ifs->name;
+    if (ifs->description)
+      entry.dev.description = ifs->description;
+    entry.dev.loopback = ifs->flags & PCAP_IF_LOOPBACK;
+    entry.dev.link = linkType(ifs->name, sysfsArphrd(ifs->name));
+    list.push_back(entry);
+  }
+
+  pcap_freealldevs(alldevsp);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.swap(list);
+}
+
+void DeviceRegistry::Private::listen() {
+  pollfd fds[2];
+  fds[0].fd = netlinkFd;
+  fds[0].events = POLLIN;
+  fds[1].fd = wakeFd;
+  fds[1].events = POLLIN;
+
+  std::vector<char> buf(16384);
+  while (true) {
+    fds[0].revents = 0;
+    fds[1].revents = 0;
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    if (fds[1].revents)
+      break;
+
+    ssize_t len = recv(netlinkFd, buf.data(), buf.size(), 0);
+    if (len < 0) {
+      // The socket buffer overflowed and some events were lost; start over.
+      if (errno == ENOBUFS)
+        enumerate();
+      continue;
+    }
+
+    for (const nlmsghdr *nh = reinterpret_cast<const nlmsghdr *>(buf.data());
+         NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+      if (nh->nlmsg_type == RTM_NEWLINK || nh->nlmsg_type == RTM_DELLINK)
+        update(nh);
+    }
+  }
+}
+
+void DeviceRegistry::Private::update(const nlmsghdr *nh) {
+  const ifinfomsg *ifi = static_cast<const ifinfomsg *>(NLMSG_DATA(nh));
+  std::string name;
+  int len = IFLA_PAYLOAD(nh);
+  for (const rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, len);
+       rta = RTA_NEXT(rta, len)) {
+    if (rta->rta_type == IFLA_IFNAME) {
+      name = static_cast<const char *>(RTA_DATA(rta));
+      break;
+    }
+  }
+
+  if (nh->nlmsg_type == RTM_DELLINK) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (it->ifindex == ifi->ifi_index) {
+        entries.erase(it);
+        break;
+      }
+    }
+    return;
+  }
+
+  if (name.empty())
+    return;
+
+  // Probing is slow, so a known device keeps its link type unless the new
+  // hardware type maps to one directly. Only new devices are probed.
+  int link = linkTypeFromArphrd(ifi->ifi_type);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Entry &entry : entries) {
+      if (entry.ifindex == ifi->ifi_index) {
+        entry.dev.id = name;
+        entry.dev.name = name;
+        entry.dev.loopback = ifi->ifi_flags & IFF_LOOPBACK;
+        if (link >= 0)
+          entry.dev.link = link;
+        return;
+      }
+    }
+  }
+
+  Entry entry;
+  entry.ifindex = ifi->ifi_index;
+  entry.dev.id = name;
+  entry.dev.name = name;
+  entry.dev.loopback = ifi->ifi_flags & IFF_LOOPBACK;
+  entry.dev.link = link >= 0 ? link : probeLinkType(name);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.push_back(entry);
+}
+
+DeviceRegistry &DeviceRegistry::instance() {
+  static DeviceRegistry registry;
+  return registry;
+}
+
+DeviceRegistry::DeviceRegistry() : d(new Private()) {}
+
+DeviceRegistry::~DeviceRegistry() {}
+
+std::vector<Pcap::Device> DeviceRegistry::devices() const {
+  std::lock_guard<std::mutex> lock(d->mutex);
+  std::vector<Pcap::Device> devs;
+  for (const Entry &entry : d->entries) {
+    devs.push_back(entry.dev);
+  }
+  return devs;
+}
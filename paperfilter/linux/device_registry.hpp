@@ -0,0 +1,25 @@
+#ifndef DEVICE_REGISTRY_HPP
+#define DEVICE_REGISTRY_HPP
+
+#include "pcap.hpp"
+#include <memory>
+#include <vector>
+
+class DeviceRegistry {
+public:
+  static DeviceRegistry &instance();
+  ~DeviceRegistry();
+  DeviceRegistry(const DeviceRegistry &) = delete;
+  DeviceRegistry &operator=(const DeviceRegistry &) = delete;
+
+  std::vector<Pcap::Device> devices() const;
+
+private:
+  DeviceRegistry();
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
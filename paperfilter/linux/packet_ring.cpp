@@ -0,0 +1,326 @@
+#include "packet_ring.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <pcap.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+std::string errorString(const std::string &func) {
+  return func + "() failed: " + strerror(errno);
+}
+}
+
+class PacketRing::Private {
+public:
+  Private();
+  ~Private();
+  tpacket_block_desc *block(int index) const;
+
+public:
+  int fd = -1;
+  int wakeFd = -1;
+  int ifindex = 0;
+  int linkType = -1;
+  int snaplen = 0;
+  bool promisc = false;
+  uint8_t *map = nullptr;
+  size_t mapSize = 0;
+  int blockSize = 0;
+  int blockCount = 0;
+  int current = 0;
+  std::atomic<bool> closed;
+  std::vector<uint8_t> vlanBuffer;
+  PacketRing::Stats stats;
+};
+
+PacketRing::Private::Private() : closed(false) {}
+
+PacketRing::Private::~Private() {}
+
+tpacket_block_desc *PacketRing::Private::block(int index) const {
+  return reinterpret_cast<tpacket_block_desc *>(
+      map + static_cast<size_t>(index) * blockSize);
+}
+
+PacketRing::PacketRing() : d(new Private()) {}
+
+PacketRing::~PacketRing() { close(); }
+
+bool PacketRing::open(const std::string &ifs, int snaplen, bool promisc,
+                      const Pcap::RingOption &option, std::string *error) {
+  close();
+  d->stats = Stats();
+
+  d->ifindex = if_nametoindex(ifs.c_str());
+  if (d->ifindex == 0) {
+    if (error)
+      error->assign(errorString("if_nametoindex"));
+    return false;
+  }
+
+  // The socket is not bound to any protocol until activate() so that nothing
+  // is queued before the filter is attached.
+  d->fd = socket(AF_PACKET, SOCK_RAW, 0);
+  if (d->fd < 0) {
+    if (error)
+      error->assign(errorString("socket"));
+    return false;
+  }
+
+  ifreq ifr;
+  memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, ifs.c_str(), sizeof(ifr.ifr_name) - 1);
+  if (ioctl(d->fd, SIOCGIFHWADDR, &ifr) == 0) {
+    d->linkType = ifr.ifr_hwaddr.sa_family;
+  }
+
+  int version = TPACKET_V3;
+  if (setsockopt(d->fd, SOL_PACKET, PACKET_VERSION, &version,
+                 sizeof(version)) < 0) {
+    if (error)
+      error->assign(errorString("setsockopt(PACKET_VERSION)"));
+    close();
+    return false;
+  }
+
+  const int pageSize = sysconf(_SC_PAGESIZE);
+  const int frameSize = TPACKET_ALIGN(TPACKET3_HDRLEN + snaplen);
+  int blockSize = std::max(option.blockSize, frameSize);
+  blockSize = (blockSize + pageSize - 1) / pageSize * pageSize;
+
+  tpacket_req3 req;
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = blockSize;
+  req.tp_block_nr = std::max(option.blockCount, 1);
+  req.tp_frame_size = frameSize;
+  req.tp_frame_nr = (blockSize / frameSize) * req.tp_block_nr;
+  req.tp_retire_blk_tov = std::max(option.blockTimeout, 1);
+  req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+
+  if (setsockopt(d->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+    if (error)
+      error->assign(errorString("setsockopt(PACKET_RX_RING)"));
+    close();
+    return false;
+  }
+
+  d->mapSize = static_cast<size_t>(req.tp_block_size) * req.tp_block_nr;
+  void *map =
+      mmap(nullptr, d->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, d->fd, 0);
+  if (map == MAP_FAILED) {
+    if (error)
+      error->assign(errorString("mmap"));
+    close();
+    return false;
+  }
+
+  d->map = static_cast<uint8_t *>(map);
+  d->blockSize = req.tp_block_size;
+  d->blockCount = req.tp_block_nr;
+  d->current = 0;
+  d->snaplen = snaplen;
+  d->promisc = promisc;
+  d->wakeFd = eventfd(0, EFD_NONBLOCK);
+  d->closed = false;
+  return setFilter(nullptr, error);
+}
+
+bool PacketRing::setFilter(const bpf_program *bpf, std::string *error) {
+  if (d->fd < 0)
+    return false;
+
+  // Without a user filter, a single "ret #snaplen" instruction lets the kernel
+  // truncate frames before they are copied into the ring.
+  sock_filter snap = {BPF_RET | BPF_K, 0, 0, static_cast<__u32>(d->snaplen)};
+  sock_fprog prog;
+  if (bpf && bpf->bf_len > 0) {
+    prog.len = bpf->bf_len;
+    prog.filter = reinterpret_cast<sock_filter *>(bpf->bf_insns);
+  } else {
+    prog.len = 1;
+    prog.filter = &snap;
+  }
+
+  if (setsockopt(d->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) <
+      0) {
+    if (error)
+      error->assign(errorString("setsockopt(SO_ATTACH_FILTER)"));
+    return false;
+  }
+  return true;
+}
+
+bool PacketRing::activate(std::string *error) {
+  if (d->fd < 0)
+    return false;
+
+  sockaddr_ll sll;
+  memset(&sll, 0, sizeof(sll));
+  sll.sll_family = AF_PACKET;
+  sll.sll_protocol = htons(ETH_P_ALL);
+  sll.sll_ifindex = d->ifindex;
+  if (bind(d->fd, reinterpret_cast<sockaddr *>(&sll), sizeof(sll)) < 0) {
+    if (error)
+      error->assign(errorString("bind"));
+    return false;
+  }
+
+  if (d->promisc) {
+    packet_mreq mr;
+    memset(&mr, 0, sizeof(mr));
+    mr.mr_ifindex = d->ifindex;
+    mr.mr_type = PACKET_MR_PROMISC;
+    if (setsockopt(d->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mr,
+                   sizeof(mr)) < 0) {
+      if (error)
+        error->assign(errorString("setsockopt(PACKET_ADD_MEMBERSHIP)"));
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PacketRing::setFanout(int group, Pcap::FanoutMode mode,
+                           std::string *error) {
+  if (d->fd < 0)
+    return false;
+
+  int type = PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+  switch (mode) {
+  case Pcap::FANOUT_CPU:
+    type = PACKET_FANOUT_CPU;
+    break;
+  case Pcap::FANOUT_LB:
+    type = PACKET_FANOUT_LB;
+    break;
+  default:
+    break;
+  }
+
+  int arg = (group & 0xffff) | (type << 16);
+  if (setsockopt(d->fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg)) < 0) {
+    if (error)
+      error->assign(errorString("setsockopt(PACKET_FANOUT)"));
+    return false;
+  }
+  return true;
+}
+
+PacketRing::Stats PacketRing::stats() {
+  // The kernel resets its counters on every read, so they are accumulated
+  // here.
+  if (d->fd >= 0) {
+    tpacket_stats_v3 st;
+    socklen_t len = sizeof(st);
+    memset(&st, 0, sizeof(st));
+    if (getsockopt(d->fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0) {
+      d->stats.packets += st.tp_packets;
+      d->stats.drops += st.tp_drops;
+      d->stats.freezes += st.tp_freeze_q_cnt;
+    }
+  }
+  return d->stats;
+}
+
+void PacketRing::close() {
+  if (d->map) {
+    munmap(d->map, d->mapSize);
+    d->map = nullptr;
+    d->mapSize = 0;
+  }
+  if (d->fd >= 0) {
+    ::close(d->fd);
+    d->fd = -1;
+  }
+  if (d->wakeFd >= 0) {
+    ::close(d->wakeFd);
+    d->wakeFd = -1;
+  }
+}
+
+void PacketRing::loop(
+    const std::function<void(const pcap_pkthdr *, const uint8_t *)> &cb,
+    const std::function<void()> &blockCb) {
+  pollfd fds[2];
+  fds[0].fd = d->fd;
+  fds[0].events = POLLIN | POLLERR;
+  fds[1].fd = d->wakeFd;
+  fds[1].events = POLLIN;
+
+  while (!d->closed) {
+    tpacket_block_desc *block = d->block(d->current);
+    if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+          TP_STATUS_USER)) {
+      fds[0].revents = 0;
+      fds[1].revents = 0;
+      if (poll(fds, 2, -1) < 0 && errno != EINTR)
+        break;
+      continue;
+    }
+
+    const uint8_t *base = reinterpret_cast<const uint8_t *>(block);
+    const tpacket3_hdr *hdr = reinterpret_cast<const tpacket3_hdr *>(
+        base + block->hdr.bh1.offset_to_first_pkt);
+
+    for (uint32_t i = 0; i < block->hdr.bh1.num_pkts; ++i) {
+      // The ring always reports nanoseconds; tv_usec carries them as-is, the
+      // same way libpcap does with PCAP_TSTAMP_PRECISION_NANO.
+      pcap_pkthdr h;
+      h.ts.tv_sec = hdr->tp_sec;
+      h.ts.tv_usec = hdr->tp_nsec;
+      h.caplen = std::min<uint32_t>(hdr->tp_snaplen, d->snaplen);
+      h.len = hdr->tp_len;
+      const uint8_t *data =
+          reinterpret_cast<const uint8_t *>(hdr) + hdr->tp_mac;
+
+      // The kernel strips 802.1Q tags into the frame header; put them back so
+      // that the dissectors see the frame as it was on the wire.
+      if ((hdr->tp_status & TP_STATUS_VLAN_VALID) &&
+          d->linkType == ARPHRD_ETHER && h.caplen >= 2 * ETH_ALEN) {
+        uint16_t tpid = (hdr->tp_status & TP_STATUS_VLAN_TPID_VALID)
+                            ? hdr->hv1.tp_vlan_tpid
+                            : ETH_P_8021Q;
+        uint16_t tag[2] = {htons(tpid), htons(hdr->hv1.tp_vlan_tci)};
+        d->vlanBuffer.assign(data, data + 2 * ETH_ALEN);
+        d->vlanBuffer.insert(d->vlanBuffer.end(),
+                             reinterpret_cast<const uint8_t *>(tag),
+                             reinterpret_cast<const uint8_t *>(tag) + 4);
+        d->vlanBuffer.insert(d->vlanBuffer.end(), data + 2 * ETH_ALEN,
+                             data + h.caplen);
+        h.caplen = std::min<uint32_t>(h.caplen + 4, d->snaplen);
+        h.len += 4;
+        data = d->vlanBuffer.data();
+      }
+
+      cb(&h, data);
+      hdr = reinterpret_cast<const tpacket3_hdr *>(
+          reinterpret_cast<const uint8_t *>(hdr) + hdr->tp_next_offset);
+    }
+
+    __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL,
+                     __ATOMIC_RELEASE);
+    if (blockCb)
+      blockCb();
+    d->current = (d->current + 1) % d->blockCount;
+  }
+}
+
+void PacketRing::breakloop() {
+  d->closed = true;
+  if (d->wakeFd >= 0)
+    eventfd_write(d->wakeFd, 1);
+}
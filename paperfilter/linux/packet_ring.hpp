@@ -0,0 +1,45 @@
+#ifndef PACKET_RING_HPP
+#define PACKET_RING_HPP
+
+#include "pcap.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+struct pcap_pkthdr;
+struct bpf_program;
+
+class PacketRing {
+public:
+  struct Stats {
+    uint64_t packets = 0;
+    uint64_t drops = 0;
+    uint64_t freezes = 0;
+  };
+
+public:
+  PacketRing();
+  ~PacketRing();
+  PacketRing(const PacketRing &) = delete;
+  PacketRing &operator=(const PacketRing &) = delete;
+
+  bool open(const std::string &ifs, int snaplen, bool promisc,
+            const Pcap::RingOption &option, std::string *error);
+  bool setFilter(const bpf_program *bpf, std::string *error);
+  bool activate(std::string *error);
+  bool setFanout(int group, Pcap::FanoutMode mode, std::string *error);
+  void close();
+  Stats stats();
+
+  void
+  loop(const std::function<void(const pcap_pkthdr *, const uint8_t *)> &cb,
+       const std::function<void()> &blockCb);
+  void breakloop();
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
@@ -1 +1,369 @@
-#include "../darwin/pcap.cpp"
+#include "pcap.hpp"
+#include "../packet.hpp"
+#include "../log_message.hpp"
+#include "../packet_batcher.hpp"
+#include "../batch_sequencer.hpp"
+#include "device_registry.hpp"
+#include "packet_ring.hpp"
+#include <atomic>
+#include <mutex>
+#include <pcap.h>
+#include <signal.h>
+#include <thread>
+#include <unistd.h>
+
+class Pcap::Private {
+public:
+  Private(const std::shared_ptr<Context> &ctx);
+  void log(LogMessage::Level level, const std::string &message);
+  pcap_t *open();
+  void addStats(Stats *total) const;
+  PacketBatcher::Callback batchCallback();
+  bool startRing();
+  void runRing(PacketRing *ring);
+  void runFanout(PacketRing *ring);
+
+public:
+  std::mutex mutex;
+  std::thread thread;
+  pcap_t *pcap = nullptr;
+  bool nanosecond = false;
+  std::vector<std::unique_ptr<PacketRing>> rings;
+  std::vector<std::thread> ringThreads;
+  std::unique_ptr<BatchSequencer> sequencer;
+
+  std::shared_ptr<Context> ctx;
+  bpf_program bpf = {0, nullptr};
+  std::string networkInterface;
+  bool promiscuous = false;
+  int snaplen = 2048;
+  Backend backend = BACKEND_PCAP;
+  RingOption ringOption;
+  PcapOption pcapOption;
+  BatchOption batchOption;
+
+  // Counters of handles that have already been closed, so that stats() keeps
+  // growing across restarts.
+  Stats closedStats;
+};
+
+Pcap::Private::Private(const std::shared_ptr<Context> &ctx) : ctx(ctx) {}
+
+void Pcap::Private::addStats(Stats *total) const {
+  pcap_stat ps;
+  if (pcap && pcap_stats(pcap, &ps) == 0) {
+    total->received += ps.ps_recv;
+    total->dropped += ps.ps_drop;
+    total->ifdropped += ps.ps_ifdrop;
+  }
+  for (const auto &ring : rings) {
+    const PacketRing::Stats &rs = ring->stats();
+    total->received += rs.packets;
+    total->dropped += rs.drops;
+    total->freezes += rs.freezes;
+  }
+}
+
+PacketBatcher::Callback Pcap::Private::batchCallback() {
+  return [this](std::vector<std::unique_ptr<Packet>> packets) {
+    if (ctx->packetsCb) {
+      ctx->packetsCb(std::move(packets));
+    } else if (ctx->packetCb) {
+      for (auto &pkt : packets) {
+        ctx->packetCb(std::move(pkt));
+      }
+    }
+  };
+}
+
+void Pcap::Private::log(LogMessage::Level level, const std::string &message) {
+  if (ctx->logCb) {
+    LogMessage msg;
+    msg.level = level;
+    msg.message = message;
+    msg.domain = "pcap";
+    ctx->logCb(msg);
+  }
+}
+
+pcap_t *Pcap::Private::open() {
+  char err[PCAP_ERRBUF_SIZE] = {'\0'};
+  pcap_t *p = pcap_create(networkInterface.c_str(), err);
+  if (!p) {
+    log(LogMessage::LEVEL_ERROR, std::string("pcap_create() failed: ") + err);
+    return nullptr;
+  }
+
+  pcap_set_snaplen(p, snaplen);
+  pcap_set_promisc(p, promiscuous);
+  pcap_set_timeout(p, pcapOption.timeout);
+  if (pcapOption.bufferSize > 0)
+    pcap_set_buffer_size(p, pcapOption.bufferSize);
+  pcap_set_immediate_mode(p, pcapOption.immediate);
+  if (pcapOption.nanosecond)
+    pcap_set_tstamp_precision(p, PCAP_TSTAMP_PRECISION_NANO);
+
+  int status = pcap_activate(p);
+  if (status < 0) {
+    log(LogMessage::LEVEL_ERROR, std::string("pcap_activate() failed: ") +
+                                     pcap_statustostr(status) + ": " +
+                                     pcap_geterr(p));
+    pcap_close(p);
+    return nullptr;
+  } else if (status > 0) {
+    log(LogMessage::LEVEL_WARN,
+        std::string("pcap_activate(): ") + pcap_statustostr(status));
+  }
+
+  nanosecond = pcap_get_tstamp_precision(p) == PCAP_TSTAMP_PRECISION_NANO;
+  return p;
+}
+
+bool Pcap::Private::startRing() {
+  static std::atomic<int> fanoutGroup(0);
+  int group = (getpid() + fanoutGroup++) & 0xffff;
+  int fanout = std::max(ringOption.fanout, 1);
+
+  // The kernel only lets bound sockets join a fanout group, and frames that
+  // arrive in between reach every socket. They are dropped by a filter that
+  // is replaced once the group has been joined.
+  bpf_insn dropAll = BPF_STMT(BPF_RET | BPF_K, 0);
+  bpf_program drop = {1, &dropAll};
+
+  std::string err;
+  for (int i = 0; i < fanout; ++i) {
+    std::unique_ptr<PacketRing> ring(new PacketRing());
+    if (!ring->open(networkInterface, snaplen, promiscuous, ringOption,
+                    &err) ||
+        !ring->setFilter(fanout > 1 ? &drop : &bpf, &err) ||
+        !ring->activate(&err) ||
+        (fanout > 1 && (!ring->setFanout(group, ringOption.fanoutMode, &err) ||
+                        !ring->setFilter(&bpf, &err)))) {
+      log(LogMessage::LEVEL_ERROR, err);
+      rings.clear();
+      return false;
+    }
+    rings.push_back(std::move(ring));
+  }
+
+  if (fanout == 1) {
+    ringThreads.emplace_back(&Private::runRing, this, rings.front().get());
+    return true;
+  }
+
+  sequencer.reset(new BatchSequencer(batchCallback()));
+  for (const auto &ring : rings) {
+    ringThreads.emplace_back(&Private::runFanout, this, ring.get());
+  }
+  return true;
+}
+
+void Pcap::Private::runRing(PacketRing *ring) {
+  PacketBatcher batcher(batchCallback(), batchOption.size,
+                        batchOption.timeout);
+  ring->loop(
+      [&batcher](const struct pcap_pkthdr *h, const uint8_t *bytes) {
+        batcher.push(std::unique_ptr<Packet>(new Packet(h, bytes, true)));
+      },
+      [&batcher]() { batcher.flush(); });
+  batcher.flush();
+}
+
+void Pcap::Private::runFanout(PacketRing *ring) {
+  // Each block becomes one batch. The ticket is taken when the first frame of
+  // the block is read, so batches reach the dispatcher in the order the
+  // blocks were pulled off the sockets, whichever thread finishes first.
+  std::vector<std::unique_ptr<Packet>> packets;
+  uint64_t ticket = 0;
+  ring->loop(
+      [this, &packets, &ticket](const struct pcap_pkthdr *h,
+                                const uint8_t *bytes) {
+        if (packets.empty())
+          ticket = sequencer->ticket();
+        packets.emplace_back(new Packet(h, bytes, true));
+      },
+      [this, &packets, &ticket]() {
+        if (!packets.empty())
+          sequencer->push(ticket, std::move(packets));
+        packets.clear();
+      });
+  if (!packets.empty())
+    sequencer->push(ticket, std::move(packets));
+}
+
+Pcap::Pcap(const std::shared_ptr<Context> &ctx) : d(new Private(ctx)) {}
+
+Pcap::~Pcap() { stop(); }
+
+std::vector<Pcap::Device> Pcap::devices() {
+  return DeviceRegistry::instance().devices();
+}
+
+bool Pcap::compile(const std::string &filter, int linkType, int snaplen,
+                   std::vector<Instruction> *program, std::string *error) {
+  pcap_t *pcap = pcap_open_dead(linkType, snaplen);
+  if (!pcap) {
+    if (error)
+      error->assign("pcap_open_dead() failed");
+    return false;
+  }
+
+  bpf_program bpf;
+  if (pcap_compile(pcap, &bpf, filter.c_str(), true, PCAP_NETMASK_UNKNOWN) <
+      0) {
+    if (error)
+      error->assign(pcap_geterr(pcap));
+    pcap_close(pcap);
+    return false;
+  }
+
+  program->clear();
+  for (u_int i = 0; i < bpf.bf_len; ++i) {
+    const bpf_insn &insn = bpf.bf_insns[i];
+    Instruction inst = {insn.code, insn.jt, insn.jf, insn.k};
+    program->push_back(inst);
+  }
+
+  pcap_freecode(&bpf);
+  pcap_close(pcap);
+  return true;
+}
+
+void Pcap::setInterface(const std::string &ifs) { d->networkInterface = ifs; }
+
+std::string Pcap::networkInterface() const { return d->networkInterface; }
+
+void Pcap::setPromiscuous(bool promisc) { d->promiscuous = promisc; }
+
+bool Pcap::promiscuous() const { return d->promiscuous; }
+
+void Pcap::setSnaplen(int len) { d->snaplen = len; }
+
+int Pcap::snaplen() const { return d->snaplen; }
+
+bool Pcap::setBPF(const std::string &filter, std::string *error) {
+  pcap_freecode(&d->bpf);
+  d->bpf.bf_len = 0;
+  d->bpf.bf_insns = nullptr;
+
+  if (filter.empty())
+    return true;
+
+  char err[PCAP_ERRBUF_SIZE] = {'\0'};
+  pcap_t *pcap = pcap_open_live(d->networkInterface.c_str(), d->snaplen,
+                                d->promiscuous, 1, err);
+  if (!pcap) {
+    if (error)
+      error->assign(err);
+    return false;
+  }
+
+  if (pcap_compile(pcap, &d->bpf, filter.c_str(), true, PCAP_NETMASK_UNKNOWN) <
+      0) {
+    if (error)
+      error->assign(pcap_geterr(pcap));
+    pcap_close(pcap);
+    return false;
+  }
+
+  pcap_close(pcap);
+  return true;
+}
+
+void Pcap::setBackend(Backend backend) { d->backend = backend; }
+
+Pcap::Backend Pcap::backend() const { return d->backend; }
+
+void Pcap::setRingOption(const RingOption &option) { d->ringOption = option; }
+
+Pcap::RingOption Pcap::ringOption() const { return d->ringOption; }
+
+void Pcap::setPcapOption(const PcapOption &option) { d->pcapOption = option; }
+
+Pcap::PcapOption Pcap::pcapOption() const { return d->pcapOption; }
+
+void Pcap::setBatchOption(const BatchOption &option) {
+  d->batchOption = option;
+}
+
+Pcap::BatchOption Pcap::batchOption() const { return d->batchOption; }
+
+Pcap::Stats Pcap::stats() const {
+  std::lock_guard<std::mutex> lock(d->mutex);
+  Stats total = d->closedStats;
+  d->addStats(&total);
+  return total;
+}
+
+void Pcap::start() {
+  stop();
+
+  std::lock_guard<std::mutex> lock(d->mutex);
+
+  if (d->backend == BACKEND_RING) {
+    d->startRing();
+    return;
+  }
+
+  d->pcap = d->open();
+  if (!d->pcap)
+    return;
+
+  if (d->bpf.bf_len > 0 && pcap_setfilter(d->pcap, &d->bpf) < 0) {
+    d->log(LogMessage::LEVEL_ERROR, "pcap_setfilter() failed");
+    pcap_close(d->pcap);
+    d->pcap = nullptr;
+    return;
+  }
+
+  d->thread = std::thread([this]() {
+    struct Handler {
+      PacketBatcher *batcher;
+      bool nanosecond;
+    };
+    PacketBatcher batcher(d->batchCallback(), d->batchOption.size,
+                          d->batchOption.timeout);
+    Handler handler = {&batcher, d->nanosecond};
+    while (pcap_dispatch(d->pcap, -1,
+                         [](u_char *user, const struct pcap_pkthdr *h,
+                            const u_char *bytes) {
+                           Handler &handler =
+                               *reinterpret_cast<Handler *>(user);
+                           handler.batcher->push(std::unique_ptr<Packet>(
+                               new Packet(h, bytes, handler.nanosecond)));
+                         },
+                         reinterpret_cast<u_char *>(&handler)) >= 0) {
+      batcher.poll();
+    }
+    batcher.flush();
+    {
+      std::lock_guard<std::mutex> lock(d->mutex);
+      d->addStats(&d->closedStats);
+      pcap_close(d->pcap);
+      d->pcap = nullptr;
+    }
+  });
+}
+
+void Pcap::stop() {
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    if (d->pcap)
+      pcap_breakloop(d->pcap);
+    for (const auto &ring : d->rings)
+      ring->breakloop();
+  }
+  if (d->thread.joinable())
+    d->thread.join();
+  for (auto &thread : d->ringThreads) {
+    if (thread.joinable())
+      thread.join();
+  }
+  d->ringThreads.clear();
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->addStats(&d->closedStats);
+    d->rings.clear();
+  }
+  d->sequencer.reset();
+}
@@ -0,0 +1,187 @@
+#include "namespace_matcher.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <regex>
+#include <unordered_map>
+
+namespace {
+const size_t shardCount = 16;
+
+struct Regex {
+  size_t index;
+  std::regex regex;
+  std::vector<std::string> literals;
+};
+
+typedef std::shared_ptr<const NamespaceMatcher::Indices> IndicesPtr;
+
+struct Shard {
+  std::mutex mutex;
+  std::unordered_map<std::string, IndicesPtr> entries;
+};
+
+// Returns the position of the character closing the bracket or group that
+// starts at pos.
+size_t skip(const std::string &regex, size_t pos) {
+  const char open = regex[pos];
+  int depth = 0;
+  for (size_t i = pos; i < regex.size(); ++i) {
+    const char c = regex[i];
+    if (c == '\\') {
+      ++i;
+    } else if (open == '[') {
+      if (c == ']' && i > pos)
+        return i;
+    } else if (c == '[') {
+      i = skip(regex, i);
+    } else if (c == '(') {
+      ++depth;
+    } else if (c == ')' && --depth == 0) {
+      return i;
+    }
+  }
+  return regex.size();
+}
+}
+
+class NamespaceMatcher::Private {
+public:
+  std::shared_ptr<const Indices> compute(const std::string &ns) const;
+
+public:
+  std::unordered_map<std::string, Indices> strings;
+  std::vector<Regex> regexes;
+  size_t shardSize;
+  mutable Shard shards[shardCount];
+};
+
+std::shared_ptr<const NamespaceMatcher::Indices>
+NamespaceMatcher::Private::compute(const std::string &ns) const {
+  auto indices = std::make_shared<Indices>();
+  auto it = strings.find(ns);
+  if (it != strings.end())
+    *indices = it->second;
+
+  for (const Regex &regex : regexes) {
+    bool candidate = true;
+    for (const std::string &literal : regex.literals) {
+      if (ns.find(literal) == std::string::npos) {
+        candidate = false;
+        break;
+      }
+    }
+    if (candidate && std::regex_match(ns, regex.regex))
+      indices->push_back(regex.index);
+  }
+
+  std::sort(indices->begin(), indices->end());
+  indices->erase(std::unique(indices->begin(), indices->end()),
+                 indices->end());
+  return indices;
+}
+
+NamespaceMatcher::NamespaceMatcher(const std::vector<Pattern> &patterns,
+                                   size_t cacheSize)
+    : d(new Private()) {
+  d->shardSize = std::max<size_t>(1, cacheSize / shardCount);
+  for (size_t index = 0; index < patterns.size(); ++index) {
+    for (const std::string &str : patterns[index].strings) {
+      Indices &indices = d->strings[str];
+      if (indices.empty() || indices.back() != index)
+        indices.push_back(index);
+    }
+    for (const std::string &source : patterns[index].regexes) {
+      // Patterns that std::regex cannot parse never match.
+      try {
+        Regex regex;
+        regex.index = index;
+        regex.regex = std::regex(source, std::regex::optimize);
+        regex.literals = requiredLiterals(source);
+        d->regexes.push_back(std::move(regex));
+      } catch (const std::regex_error &) {
+      }
+    }
+  }
+}
+
+NamespaceMatcher::~NamespaceMatcher() {}
+
+std::shared_ptr<const NamespaceMatcher::Indices>
+NamespaceMatcher::match(const std::string &ns) const {
+  Shard &shard = d->shards[std::hash<std::string>()(ns) % shardCount];
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(ns);
+    if (it != shard.entries.end())
+      return it->second;
+  }
+
+  const std::shared_ptr<const Indices> &indices = d->compute(ns);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.entries.size() >= d->shardSize)
+    shard.entries.erase(shard.entries.begin());
+  shard.entries[ns] = indices;
+  return indices;
+}
+
+std::vector<std::string>
+NamespaceMatcher::requiredLiterals(const std::string &regex) {
+  std::vector<std::string> literals;
+  std::string run;
+  const auto flush = [&literals, &run]() {
+    if (!run.empty())
+      literals.push_back(run);
+    run.clear();
+  };
+
+  for (size_t i = 0; i < regex.size(); ++i) {
+    const char c = regex[i];
+    switch (c) {
+    case '|':
+      // Groups are skipped, so this is a top-level alternation.
+      return std::vector<std::string>();
+    case '\\':
+      if (++i < regex.size()) {
+        if (std::isalnum(static_cast<unsigned char>(regex[i]))) {
+          // Classes and assertions end the literal. Any other escape, such
+          // as \x3c, \u003c, \cJ or \1, stands for text that is not decoded
+          // here, so no literal can be trusted.
+          if (!std::strchr("bBdDsSwW", regex[i]))
+            return std::vector<std::string>();
+          flush();
+        } else {
+          run += regex[i];
+        }
+      }
+      break;
+    case '[':
+    case '(':
+      flush();
+      i = skip(regex, i);
+      break;
+    case '*':
+    case '?':
+    case '{':
+      // The previous character may be absent.
+      if (!run.empty())
+        run.resize(run.size() - 1);
+      flush();
+      if (c == '{')
+        i = std::min(regex.find('}', i), regex.size());
+      break;
+    case '+':
+    case '.':
+    case '^':
+    case '$':
+      flush();
+      break;
+    default:
+      run += c;
+    }
+  }
+  flush();
+  return literals;
+}
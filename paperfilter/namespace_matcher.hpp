@@ -0,0 +1,42 @@
+#ifndef NAMESPACE_MATCHER_HPP
+#define NAMESPACE_MATCHER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Maps layer namespaces to the dissectors registered for them. All patterns
+// are compiled once and the matcher is shared by every dissector thread of a
+// session. Literal namespaces are looked up in a hash table; a regex is only
+// run when the namespace contains every literal the regex requires. Results
+// are kept in a bounded cache, so namespaces that vary per flow cannot grow
+// it without limit.
+class NamespaceMatcher {
+public:
+  struct Pattern {
+    std::vector<std::string> strings;
+    std::vector<std::string> regexes; // ECMAScript syntax, matched in full
+  };
+
+  typedef std::vector<size_t> Indices;
+
+public:
+  explicit NamespaceMatcher(const std::vector<Pattern> &patterns,
+                            size_t cacheSize = 4096);
+  ~NamespaceMatcher();
+  NamespaceMatcher(const NamespaceMatcher &) = delete;
+  NamespaceMatcher &operator=(const NamespaceMatcher &) = delete;
+
+  // Indices of the patterns matching ns, in ascending order.
+  std::shared_ptr<const Indices> match(const std::string &ns) const;
+
+  // Literals that every match of regex contains, e.g. "::Ethernet::" and
+  // "::<TCP>" for "::Ethernet::\w+::<TCP>". Empty if none can be derived.
+  static std::vector<std::string> requiredLiterals(const std::string &regex);
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
@@ -0,0 +1,585 @@
+#include "native_dissector.hpp"
+#include "buffer.hpp"
+#include "item.hpp"
+#include "item_value.hpp"
+#include "layer.hpp"
+#include "stream_chunk.hpp"
+#include <cstdio>
+
+namespace {
+const char *const protocols[] = {
+    "HOPOPT", "ICMP", "IGMP", "GGP", "IP-in-IP", "ST", "TCP", "CBT", "EGP",
+    "IGP", "BBN-RCC-MON", "NVP-II", "PUP", "ARGUS", "EMCON", "XNET", "CHAOS",
+    "UDP", "MUX", "DCN-MEAS", "HMP", "PRM", "XNS-IDP", "TRUNK-1", "TRUNK-2",
+    "LEAF-1", "LEAF-2", "RDP", "IRTP", "ISO-TP4", "NETBLT", "MFE-NSP",
+    "MERIT-INP", "DCCP", "3PC", "IDPR", "XTP", "DDP", "IDPR-CMTP", "TP++",
+    "IL", "IPv6", "SDRP", "Route", "Frag", "IDRP", "RSVP", "GRE", "MHRP",
+    "BNA", "ESP", "AH", "I-NLSP", "SWIPE", "NARP", "MOBILE", "TLSP", "SKIP",
+    "ICMP", "NoNxt", "Opts", nullptr, "CFTP", nullptr, "SAT-EXPAK",
+    "KRYPTOLAN", "RVD", "IPPC", nullptr, "SAT-MON", "VISA", "IPCU", "CPNX",
+    "CPHB", "WSN", "PVP", "BR-SAT-MON", "SUN-ND", "WB-MON", "WB-EXPAK",
+    "ISO-IP", "VMTP", "SECURE-VMTP", "VINES", "IPTM", "NSFNET-IGP", "DGP",
+    "TCF", "EIGRP", "OSPF", "Sprite-RPC", "LARP", "MTP", "AX.25", "IPIP",
+    "MICP", "SCC-SP", "ETHERIP", "ENCAP", nullptr, "GMTP", "IFMP", "PNNI",
+    "PIM", "ARIS", "SCPS", "QNX", "A/N", "IPComp", "SNP", "Compaq-Peer",
+    "IPX-in-IP", "VRRP", "PGM", nullptr, "L2TP", "DDX", "IATP", "STP", "SRP",
+    "UTI", "SMP", "SM", "PTP", "IS-IS", "FIRE", "CRTP", "CRUDP", "SSCOPMCE",
+    "IPLT", "SPS", "PIPE", "SCTP", "FC", "RSVP-E2E-IGNORE", "RFC6275",
+    "UDPLite", "MPLS-in-IP", "manet", "HIP", "Shim6", "WESP", "ROHC"};
+
+const char *protocolName(uint8_t number) {
+  if (number < sizeof(protocols) / sizeof(protocols[0]))
+    return protocols[number];
+  return nullptr;
+}
+
+const char *etherTypeName(uint16_t type) {
+  switch (type) {
+  case 0x0800:
+    return "IPv4";
+  case 0x0806:
+    return "ARP";
+  case 0x0842:
+    return "WoL";
+  case 0x809b:
+    return "AppleTalk";
+  case 0x80f3:
+    return "AARP";
+  case 0x86dd:
+    return "IPv6";
+  default:
+    return nullptr;
+  }
+}
+
+uint16_t load16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+
+uint32_t load32(const uint8_t *p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) |
+         p[3];
+}
+
+std::string range(size_t start, size_t end) {
+  return std::to_string(start) + ":" + std::to_string(end);
+}
+
+std::string rangeFrom(size_t start) { return std::to_string(start) + ":"; }
+
+ItemValue number(double value) { return ItemValue(value); }
+
+ItemValue text(const std::string &value) {
+  return ItemValue(value, std::string());
+}
+
+std::shared_ptr<Item> makeItem(const std::string &name, const std::string &id,
+                               const std::string &range,
+                               const ItemValue &value) {
+  auto item = std::make_shared<Item>();
+  item->setName(name);
+  item->setId(id);
+  item->setRange(range);
+  item->setValue(value);
+  return item;
+}
+
+// A numeric item with a single "Name" child, as driptool's Enum renders.
+std::shared_ptr<Item> makeEnumItem(const std::string &name,
+                                   const std::string &id,
+                                   const std::string &range, uint32_t value,
+                                   const char *label) {
+  const std::string str = label ? label : "Unknown";
+  auto item = makeItem(name, id, range, number(value));
+  item->setSummary(str);
+  item->addItem(makeItem("Name", "name", range, text(str)));
+  return item;
+}
+
+std::string macAddress(const uint8_t *p) {
+  char str[18];
+  snprintf(str, sizeof(str), "%02x:%02x:%02x:%02x:%02x:%02x", p[0], p[1],
+           p[2], p[3], p[4], p[5]);
+  return str;
+}
+
+std::string ipv4Address(const uint8_t *p) {
+  char str[16];
+  snprintf(str, sizeof(str), "%u.%u.%u.%u", p[0], p[1], p[2], p[3]);
+  return str;
+}
+
+// RFC 5952 text form: the longest run of zero groups is collapsed.
+std::string ipv6Address(const uint8_t *p) {
+  uint16_t groups[8];
+  for (int i = 0; i < 8; ++i)
+    groups[i] = load16(p + i * 2);
+
+  int bestStart = -1;
+  int bestLength = 1;
+  for (int i = 0; i < 8;) {
+    int j = i;
+    while (j < 8 && groups[j] == 0)
+      ++j;
+    if (j - i > bestLength) {
+      bestStart = i;
+      bestLength = j - i;
+    }
+    i = j > i ? j : i + 1;
+  }
+
+  std::string str;
+  char group[5];
+  for (int i = 0; i < 8; ++i) {
+    if (i == bestStart) {
+      str += "::";
+      i += bestLength - 1;
+      continue;
+    }
+    if (!str.empty() && str.back() != ':')
+      str += ':';
+    snprintf(group, sizeof(group), "%x", groups[i]);
+    str += group;
+  }
+  return str;
+}
+
+std::string flagsString(uint32_t value, const char *const names[],
+                        const uint32_t bits[], size_t count) {
+  std::string str;
+  for (size_t i = 0; i < count; ++i) {
+    if (value & bits[i]) {
+      if (!str.empty())
+        str += ", ";
+      str += names[i];
+    }
+  }
+  return str;
+}
+
+std::string replace(std::string str, const std::string &from,
+                    const std::string &to) {
+  size_t pos = str.find(from);
+  if (pos != std::string::npos)
+    str.replace(pos, from.size(), to);
+  return str;
+}
+
+// Builds the "src"/"dst" host values of a transport layer from the address
+// items of its IP parent.
+bool hosts(const Layer &parent, uint16_t srcPort, uint16_t dstPort,
+           ItemValue *src, ItemValue *dst) {
+  const std::shared_ptr<Item> &srcAddr = parent.item("src");
+  const std::shared_ptr<Item> &dstAddr = parent.item("dst");
+  if (!srcAddr || !dstAddr)
+    return false;
+  const ItemValue &srcValue = srcAddr->value();
+  const ItemValue &dstValue = dstAddr->value();
+  const std::string &type = srcValue.type();
+  if (type == "dripcap/ipv4/addr") {
+    *src = ItemValue(srcValue.str() + ":" + std::to_string(srcPort),
+                     "dripcap/ipv4/host");
+    *dst = ItemValue(dstValue.str() + ":" + std::to_string(dstPort),
+                     "dripcap/ipv4/host");
+  } else if (type == "dripcap/ipv6/addr") {
+    *src = ItemValue("[" + srcValue.str() + "]:" + std::to_string(srcPort),
+                     "dripcap/ipv6/host");
+    *dst = ItemValue("[" + dstValue.str() + "]:" + std::to_string(dstPort),
+                     "dripcap/ipv6/host");
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool analyzeEthernet(const Layer &parent,
+                     std::vector<std::shared_ptr<Layer>> *layers,
+                     std::vector<std::unique_ptr<StreamChunk>> *) {
+  std::unique_ptr<Buffer> payload = parent.payload();
+  if (!payload || payload->length() < 14)
+    return false;
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(payload->data());
+
+  auto layer = std::make_shared<Layer>("::Ethernet");
+  layer->setName("Ethernet");
+  layer->setId("eth");
+
+  const std::string &destination = macAddress(data);
+  layer->addItem(makeItem("Destination", "dst", "0:6",
+                          ItemValue(destination, "dripcap/mac")));
+  const std::string &source = macAddress(data + 6);
+  layer->addItem(
+      makeItem("Source", "src", "6:12", ItemValue(source, "dripcap/mac")));
+
+  const char *protocol = nullptr;
+  uint16_t type = load16(data + 12);
+  if (type <= 1500) {
+    layer->addItem(makeItem("Length", "len", "12:14", number(type)));
+  } else {
+    protocol = etherTypeName(type);
+    layer->addItem(
+        makeEnumItem("EtherType", "etherType", "12:14", type, protocol));
+    if (protocol)
+      layer->setNs(std::string("::Ethernet::<") + protocol + ">");
+  }
+
+  std::string summary = source + " -> " + destination;
+  if (protocol)
+    summary = std::string("[") + protocol + "] " + summary;
+  layer->setSummary(summary);
+
+  layer->setRange("14:");
+  layer->setPayload(payload->slice(14));
+  layer->addItem(makeItem("Payload", "payload", "14:",
+                          ItemValue(payload->slice(14))));
+  layers->push_back(layer);
+  return true;
+}
+
+bool analyzeIPv4(const Layer &parent,
+                 std::vector<std::shared_ptr<Layer>> *layers,
+                 std::vector<std::unique_ptr<StreamChunk>> *) {
+  std::unique_ptr<Buffer> payload = parent.payload();
+  if (!payload || payload->length() < 20)
+    return false;
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(payload->data());
+  const size_t headerLength = (data[0] & 0x0f) * 4;
+  if (headerLength < 20 || headerLength > payload->length())
+    return false;
+
+  auto layer = std::make_shared<Layer>("::Ethernet::IPv4");
+  layer->setName("IPv4");
+  layer->setId("ipv4");
+
+  layer->addItem(makeItem("Version", "version", "0:1", number(data[0] >> 4)));
+  layer->addItem(makeItem("Internet Header Length", "headerLength", "0:1",
+                          number(data[0] & 0x0f)));
+  layer->addItem(makeItem("Type of service", "type", "1:2", number(data[1])));
+  const uint16_t totalLength = load16(data + 2);
+  layer->addItem(
+      makeItem("Total Length", "totalLength", "2:4", number(totalLength)));
+  layer->addItem(
+      makeItem("Identification", "id", "4:6", number(load16(data + 4))));
+
+  static const char *const flagNames[] = {"Reserved", "Don't Fragment",
+                                          "More Fragments"};
+  static const uint32_t flagBits[] = {0x1, 0x2, 0x4};
+  const uint32_t flagValue = (data[6] >> 5) & 0x7;
+  auto flags = makeItem("Flags", "flags", "6:7", number(flagValue));
+  flags->setSummary(flagsString(flagValue, flagNames, flagBits, 3));
+  flags->addItem(makeItem("Reserved", "reserved", "6:7",
+                          ItemValue(static_cast<bool>(flagValue & 0x1))));
+  flags->addItem(makeItem("Don't Fragment", "doNotFragment", "6:7",
+                          ItemValue(static_cast<bool>(flagValue & 0x2))));
+  flags->addItem(makeItem("More Fragments", "moreFragments", "6:7",
+                          ItemValue(static_cast<bool>(flagValue & 0x4))));
+  layer->addItem(flags);
+
+  layer->addItem(makeItem("Fragment Offset", "fragmentOffset", "6:8",
+                          number(load16(data + 6) & 0x1fff)));
+  layer->addItem(makeItem("TTL", "ttl", "8:9", number(data[8])));
+
+  const char *protocol = protocolName(data[9]);
+  layer->addItem(
+      makeEnumItem("Protocol", "protocol", "9:10", data[9], protocol));
+  if (protocol)
+    layer->setNs(std::string("::Ethernet::IPv4::<") + protocol + ">");
+
+  layer->addItem(makeItem("Header Checksum", "checksum", "10:12",
+                          number(load16(data + 10))));
+  const std::string &source = ipv4Address(data + 12);
+  layer->addItem(makeItem("Source IP Address", "src", "12:16",
+                          ItemValue(source, "dripcap/ipv4/addr")));
+  const std::string &destination = ipv4Address(data + 16);
+  layer->addItem(makeItem("Destination IP Address", "dst", "16:20",
+                          ItemValue(destination, "dripcap/ipv4/addr")));
+
+  // Packets captured before TSO/GSO segmentation often have a Total Length
+  // of 0; their payload runs to the end of the frame.
+  const size_t payloadEnd =
+      totalLength >= headerLength ? totalLength : payload->length();
+  const std::string &payloadRange = range(headerLength, payloadEnd);
+  layer->setRange(payloadRange);
+  layer->setPayload(payload->slice(headerLength, payloadEnd));
+  layer->addItem(
+      makeItem("Payload", "payload", payloadRange,
+               ItemValue(payload->slice(headerLength, payloadEnd))));
+
+  std::string summary = source + " -> " + destination;
+  if (protocol)
+    summary = std::string("[") + protocol + "] " + summary;
+  layer->setSummary(summary);
+  layers->push_back(layer);
+  return true;
+}
+
+bool analyzeIPv6(const Layer &parent,
+                 std::vector<std::shared_ptr<Layer>> *layers,
+                 std::vector<std::unique_ptr<StreamChunk>> *) {
+  std::unique_ptr<Buffer> payload = parent.payload();
+  if (!payload || payload->length() < 40)
+    return false;
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(payload->data());
+  const size_t length = payload->length();
+
+  auto layer = std::make_shared<Layer>("::Ethernet::IPv6");
+  layer->setName("IPv6");
+  layer->setId("ipv6");
+
+  layer->addItem(makeItem("Version", "version", "0:1", number(data[0] >> 4)));
+  layer->addItem(
+      makeItem("Traffic Class", "trafficClass", "0:2",
+               number(((data[0] & 0x0f) << 4) | ((data[1] & 0xf0) >> 4))));
+  layer->addItem(
+      makeItem("Flow Label", "flowLevel", "1:4",
+               number(load16(data + 2) | ((data[1] & 0x0f) << 16))));
+  layer->addItem(makeItem("Payload Length", "payloadLength", "4:6",
+                          number(load16(data + 4))));
+
+  uint8_t nextHeader = data[6];
+  std::string nextHeaderRange = "6:7";
+  layer->addItem(makeItem("Next Header", "", nextHeaderRange,
+                          number(nextHeader)));
+  layer->addItem(makeItem("Hop Limit", "hopLimit", "7:8", number(data[7])));
+
+  const std::string &source = ipv6Address(data + 8);
+  layer->addItem(makeItem("Source IP Address", "src", "8:24",
+                          ItemValue(source, "dripcap/ipv6/addr")));
+  const std::string &destination = ipv6Address(data + 24);
+  layer->addItem(makeItem("Destination IP Address", "dst", "24:40",
+                          ItemValue(destination, "dripcap/ipv6/addr")));
+
+  // Only the options headers are decoded, as in the script dissector.
+  size_t offset = 40;
+  while ((nextHeader == 0 || nextHeader == 60) && offset + 2 <= length) {
+    const size_t extLength = (data[offset + 1] + 1) * 8;
+    if (offset + extLength > length)
+      return false;
+    auto ext = makeItem(nextHeader == 0 ? "Hop-by-Hop Options"
+                                        : "Destination Options",
+                        "", range(offset, offset + extLength), ItemValue());
+    nextHeader = data[offset];
+    nextHeaderRange = range(offset, offset + 1);
+    ext->addItem(makeItem("Next Header", "", nextHeaderRange,
+                          number(nextHeader)));
+    ext->addItem(makeItem("Hdr Ext Len", "", range(offset + 1, offset + 2),
+                          number(data[offset + 1])));
+    ext->addItem(makeItem("Options and Padding", "",
+                          range(offset + 2, offset + extLength),
+                          ItemValue(payload->slice(offset + 2,
+                                                   offset + extLength))));
+    layer->addItem(ext);
+    offset += extLength;
+  }
+
+  const char *protocol = protocolName(nextHeader);
+  if (protocol)
+    layer->setNs(std::string("::Ethernet::IPv6::<") + protocol + ">");
+  layer->addItem(makeEnumItem("Protocol", "protocol", nextHeaderRange,
+                              nextHeader, protocol));
+
+  layer->setRange(rangeFrom(offset));
+  layer->setPayload(payload->slice(offset));
+  layer->addItem(makeItem("Payload", "payload", rangeFrom(offset),
+                          ItemValue(payload->slice(offset))));
+
+  std::string summary = source + " -> " + destination;
+  if (protocol)
+    summary = std::string("[") + protocol + "] " + summary;
+  layer->setSummary(summary);
+  layers->push_back(layer);
+  return true;
+}
+
+bool analyzeUDP(const Layer &parent,
+                std::vector<std::shared_ptr<Layer>> *layers,
+                std::vector<std::unique_ptr<StreamChunk>> *) {
+  std::unique_ptr<Buffer> payload = parent.payload();
+  if (!payload || payload->length() < 8)
+    return false;
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(payload->data());
+
+  const uint16_t srcPort = load16(data);
+  const uint16_t dstPort = load16(data + 2);
+  ItemValue src;
+  ItemValue dst;
+  if (!hosts(parent, srcPort, dstPort, &src, &dst))
+    return false;
+
+  auto layer = std::make_shared<Layer>(replace(parent.ns(), "<UDP>", "UDP"));
+  layer->setName("UDP");
+  layer->setId("udp");
+
+  layer->addItem(makeItem("Source port", "srcPort", "0:2", number(srcPort)));
+  layer->addItem(
+      makeItem("Destination port", "dstPort", "2:4", number(dstPort)));
+  layer->addItem(makeItem("", "src", "", src));
+  layer->addItem(makeItem("", "dst", "", dst));
+
+  const uint16_t length = load16(data + 4);
+  layer->addItem(makeItem("Length", "len", "4:6", number(length)));
+  layer->addItem(
+      makeItem("Checksum", "checksum", "6:8", number(load16(data + 6))));
+
+  layer->setRange(range(8, length));
+  layer->setPayload(payload->slice(8, length));
+  layer->addItem(makeItem("Payload", "payload", range(8, length),
+                          ItemValue(payload->slice(8, length))));
+
+  layer->setSummary(src.str() + " -> " + dst.str());
+  layers->push_back(layer);
+  return true;
+}
+
+std::shared_ptr<Item> tcpOptions(const Buffer &payload, size_t end) {
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(payload.data());
+  auto options = makeItem("Options", "", range(20, end), ItemValue());
+  std::string names;
+  auto add = [&](const std::shared_ptr<Item> &item) {
+    if (!item->name().empty() && item->name() != "NOP")
+      names += (names.empty() ? "" : ",") + item->name();
+    options->addItem(item);
+  };
+
+  size_t offset = 20;
+  while (offset < end) {
+    const uint8_t kind = data[offset];
+    if (kind == 0)
+      break;
+    if (kind == 1) {
+      options->addItem(makeItem("NOP", "", range(offset, offset + 1),
+                                ItemValue()));
+      ++offset;
+      continue;
+    }
+    if (offset + 2 > end)
+      break;
+    const size_t length = data[offset + 1];
+    if (length < 2 || offset + length > end)
+      break;
+
+    const std::string &optionRange = range(offset, offset + length);
+    if (kind == 2 && length == 4) {
+      add(makeItem("Maximum segment size", "", optionRange,
+                   number(load16(data + offset + 2))));
+    } else if (kind == 3 && length == 3) {
+      add(makeItem("Window scale", "", optionRange,
+                   number(data[offset + 2])));
+    } else if (kind == 4 && length == 2) {
+      add(makeItem("Selective ACK permitted", "", optionRange, ItemValue()));
+    } else if (kind == 5) {
+      add(makeItem("Selective ACK", "", optionRange,
+                   ItemValue(payload.slice(offset + 2, offset + length))));
+    } else if (kind == 8 && length == 10) {
+      const uint32_t mt = load32(data + offset + 2);
+      const uint32_t et = load32(data + offset + 6);
+      auto item = makeItem("Timestamps", "", optionRange,
+                           text(std::to_string(mt) + " - " +
+                                std::to_string(et)));
+      item->addItem(makeItem("My timestamp", "",
+                             range(offset + 2, offset + 6), number(mt)));
+      item->addItem(makeItem("Echo reply timestamp", "",
+                             range(offset + 6, offset + 10), number(et)));
+      add(item);
+    } else {
+      add(makeItem("Unknown", "", optionRange,
+                   ItemValue(payload.slice(offset + 2, offset + length))));
+    }
+    offset += length;
+  }
+
+  options->setValue(text(names));
+  return options;
+}
+
+bool analyzeTCP(const Layer &parent,
+                std::vector<std::shared_ptr<Layer>> *layers,
+                std::vector<std::unique_ptr<StreamChunk>> *streams) {
+  std::unique_ptr<Buffer> payload = parent.payload();
+  if (!payload || payload->length() < 20)
+    return false;
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(payload->data());
+  const size_t dataOffset = data[12] >> 4;
+  const size_t headerLength = dataOffset * 4;
+  if (headerLength < 20 || headerLength > payload->length())
+    return false;
+
+  const uint16_t srcPort = load16(data);
+  const uint16_t dstPort = load16(data + 2);
+  ItemValue src;
+  ItemValue dst;
+  if (!hosts(parent, srcPort, dstPort, &src, &dst))
+    return false;
+
+  auto layer = std::make_shared<Layer>(replace(parent.ns(), "<TCP>", "TCP"));
+  layer->setName("TCP");
+  layer->setId("tcp");
+
+  layer->addItem(makeItem("Source port", "srcPort", "0:2", number(srcPort)));
+  layer->addItem(
+      makeItem("Destination port", "dstPort", "2:4", number(dstPort)));
+  layer->addItem(makeItem("", "src", "", src));
+  layer->addItem(makeItem("", "dst", "", dst));
+
+  const uint32_t seq = load32(data + 4);
+  layer->addItem(makeItem("Sequence number", "seq", "4:8", number(seq)));
+  const uint32_t ack = load32(data + 8);
+  layer->addItem(makeItem("Acknowledgment number", "ack", "8:12", number(ack)));
+  layer->addItem(
+      makeItem("Data offset", "dataOffset", "12:13", number(dataOffset)));
+
+  static const char *const flagNames[] = {"NS",  "CWR", "ECE", "URG", "ACK",
+                                          "PSH", "RST", "SYN", "FIN"};
+  static const uint32_t flagBits[] = {0x100, 0x80, 0x40, 0x20, 0x10,
+                                      0x08,  0x04, 0x02, 0x01};
+  const uint32_t flagValue = data[13] | ((data[12] & 0x1) << 8);
+  auto flags = makeItem("Flags", "flags", "12:14", number(flagValue));
+  flags->setSummary(flagsString(flagValue, flagNames, flagBits, 9));
+  for (size_t i = 0; i < 9; ++i) {
+    const bool set = flagValue & flagBits[i];
+    flags->addItem(makeItem(flagNames[i], flagNames[i],
+                            i == 0 ? "12:13" : "13:14", ItemValue(set)));
+  }
+  layer->addItem(flags);
+
+  layer->addItem(
+      makeItem("Window size", "window", "14:16", number(load16(data + 14))));
+  layer->addItem(
+      makeItem("Checksum", "checksum", "16:18", number(load16(data + 16))));
+  layer->addItem(
+      makeItem("Urgent pointer", "urgent", "18:20", number(load16(data + 18))));
+  layer->addItem(tcpOptions(*payload, headerLength));
+
+  layer->setRange(rangeFrom(headerLength));
+  layer->setPayload(payload->slice(headerLength));
+  layer->addItem(makeItem("Payload", "payload", rangeFrom(headerLength),
+                          ItemValue(payload->slice(headerLength))));
+  layer->setSummary(src.str() + " -> " + dst.str() + " seq:" +
+                    std::to_string(seq) + " ack:" + std::to_string(ack));
+
+  std::unique_ptr<StreamChunk> chunk(
+      new StreamChunk(parent.ns(), src.str() + "/" + dst.str(), layer));
+  chunk->setAttr("payload", ItemValue(payload->slice(headerLength)));
+  chunk->setAttr("seq", number(seq));
+  if ((flagValue & 0x10) && (flagValue & 0x01))
+    chunk->setEnd(true);
+
+  layers->push_back(layer);
+  streams->push_back(std::move(chunk));
+  return true;
+}
+
+const NativeDissector dissectors[] = {
+    {"ethernet", {"::<Ethernet>"}, analyzeEthernet},
+    {"ipv4", {"::Ethernet::<IPv4>"}, analyzeIPv4},
+    {"ipv6", {"::Ethernet::<IPv6>"}, analyzeIPv6},
+    {"tcp", {"::Ethernet::IPv4::<TCP>", "::Ethernet::IPv6::<TCP>"}, analyzeTCP},
+    {"udp", {"::Ethernet::IPv4::<UDP>", "::Ethernet::IPv6::<UDP>"}, analyzeUDP},
+};
+}
+
+const NativeDissector *NativeDissector::find(const std::string &name) {
+  for (const NativeDissector &diss : dissectors) {
+    if (diss.name == name)
+      return &diss;
+  }
+  return nullptr;
+}
@@ -0,0 +1,33 @@
+#ifndef NATIVE_DISSECTOR_HPP
+#define NATIVE_DISSECTOR_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Layer;
+class StreamChunk;
+
+// Built-in dissectors for the core protocols. They are matched against layer
+// namespaces like script dissectors and produce the same layers and items
+// without entering V8, so script dissectors can still build on their output.
+struct NativeDissector {
+  typedef std::function<bool(
+      const Layer &parent, std::vector<std::shared_ptr<Layer>> *layers,
+      std::vector<std::unique_ptr<StreamChunk>> *streams)>
+      AnalyzeFunc;
+
+  std::string name;
+  std::vector<std::string> namespaces;
+  AnalyzeFunc analyze;
+
+  static const NativeDissector *find(const std::string &name);
+
+  // Loads a plugin built against dissector_plugin.h. Plugins are loaded once
+  // per path and never unloaded.
+  static const NativeDissector *load(const std::string &path,
+                                     std::string *error);
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef OVERLOAD_HPP
+#define OVERLOAD_HPP
+
+#include <cstdint>
+
+// What to do with packets and stream chunks that arrive while a dissector
+// queue is at its bound.
+struct OverloadOption {
+  enum Policy {
+    POLICY_BLOCK,  // wait for room, stalling the source
+    POLICY_DROP,   // discard the newest
+    POLICY_RAW,    // store without dissecting
+    POLICY_SAMPLE, // keep one in sampleRate, discard the rest
+  };
+  Policy policy = POLICY_BLOCK;
+  uint32_t packetLimit = 1 << 18;
+  uint32_t streamLimit = 1 << 16;
+  uint32_t sampleRate = 10;
+};
+
+struct OverloadStats {
+  uint64_t blocked = 0;
+  uint64_t dropped = 0;
+  uint64_t raw = 0;
+  uint64_t sampled = 0;
+};
+
+#endif
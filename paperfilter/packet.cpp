@@ -2,6 +2,7 @@
 #include "buffer.hpp"
 #include "large_buffer.hpp"
 #include "layer.hpp"
+#include "payload_arena.hpp"
 #include "session_item_value_wrapper.hpp"
 #include <chrono>
 #include <ctime>
@@ -12,7 +13,7 @@
 
 namespace {
 std::shared_ptr<Layer> leafLayer(
-    const std::unordered_map<std::string, std::shared_ptr<Layer>> &layers) {
+    const std::unordered_map<Atom, std::shared_ptr<Layer>> &layers) {
   if (layers.empty())
     return std::shared_ptr<Layer>();
   std::shared_ptr<Layer> layer;
@@ -39,13 +40,14 @@ public:
 
 public:
   uint32_t seq = 0;
-  uint32_t ts_sec = std::chrono::seconds(std::time(NULL)).count();
+  uint32_t ts_sec = 0;
   uint32_t ts_nsec = 0;
   uint32_t length = 0;
+  uint32_t interfaceIndex = 0;
   bool vpacket = false;
   std::unique_ptr<Buffer> payload;
   std::unique_ptr<LargeBuffer> largePayload;
-  std::unordered_map<std::string, std::shared_ptr<Layer>> layers;
+  std::unordered_map<Atom, std::shared_ptr<Layer>> layers;
 };
 
 Packet::Private::Private() {}
@@ -54,15 +56,16 @@ Packet::Private::~Private() {}
 
 Packet::Packet(v8::Local<v8::Object> option) : d(new Private()) {
   Isolate *isolate = Isolate::GetCurrent();
-  v8pp::get_option(isolate, option, "ts_sec", d->ts_sec);
+  if (!v8pp::get_option(isolate, option, "ts_sec", d->ts_sec)) {
+    d->ts_sec = std::chrono::seconds(std::time(NULL)).count();
+  }
   v8pp::get_option(isolate, option, "ts_nsec", d->ts_nsec);
   v8pp::get_option(isolate, option, "length", d->length);
+  v8pp::get_option(isolate, option, "interfaceIndex", d->interfaceIndex);
   Local<Value> payload = option->Get(v8pp::to_v8(isolate, "payload"));
   if (node::Buffer::HasInstance(payload)) {
-    auto buffer = std::make_shared<std::vector<char>>();
-    buffer->assign(node::Buffer::Data(payload),
-                   node::Buffer::Data(payload) + node::Buffer::Length(payload));
-    d->payload.reset(new Buffer(buffer));
+    d->payload = PayloadArena::local().copy(node::Buffer::Data(payload),
+                                            node::Buffer::Length(payload));
     d->payload->freeze();
   }
 }
@@ -70,6 +73,7 @@ Packet::Packet(v8::Local<v8::Object> option) : d(new Private()) {
 Packet::Packet() : d(new Private()) {}
 
 Packet::Packet(std::unique_ptr<Layer> layer) : d(new Private()) {
+  d->ts_sec = std::chrono::seconds(std::time(NULL)).count();
   if (std::unique_ptr<Buffer> payload = layer->payload()) {
     d->payload = std::move(payload);
     d->payload->freeze();
@@ -82,14 +86,22 @@ Packet::Packet(std::unique_ptr<Layer> layer) : d(new Private()) {
   d->vpacket = true;
 }
 
-Packet::Packet(const struct pcap_pkthdr *h, const uint8_t *bytes)
+Packet::Packet(const struct pcap_pkthdr *h, const uint8_t *bytes,
+               bool nanosecond)
     : d(new Private()) {
   d->ts_sec = h->ts.tv_sec;
-  d->ts_nsec = h->ts.tv_usec;
+  d->ts_nsec = nanosecond ? h->ts.tv_usec : h->ts.tv_usec * 1000;
   d->length = h->len;
-  auto buffer = std::make_shared<std::vector<char>>();
-  buffer->assign(bytes, bytes + h->caplen);
-  d->payload.reset(new Buffer(buffer));
+  d->payload = PayloadArena::local().copy(reinterpret_cast<const char *>(bytes),
+                                          h->caplen);
+  d->payload->freeze();
+}
+
+Packet::Packet(std::unique_ptr<Buffer> payload, uint32_t length)
+    : d(new Private()) {
+  d->ts_sec = std::chrono::seconds(std::time(NULL)).count();
+  d->length = length;
+  d->payload = std::move(payload);
   d->payload->freeze();
 }
 
@@ -103,6 +115,11 @@ uint32_t Packet::ts_sec() const { return d->ts_sec; }
 
 uint32_t Packet::ts_nsec() const { return d->ts_nsec; }
 
+void Packet::setTimestamp(uint32_t sec, uint32_t nsec) {
+  d->ts_sec = sec;
+  d->ts_nsec = nsec;
+}
+
 std::string Packet::summary() const {
   const std::shared_ptr<Layer> &leaf = leafLayer(layers());
   if (leaf) {
@@ -115,6 +132,10 @@ bool Packet::vpacket() const { return d->vpacket; }
 
 uint32_t Packet::length() const { return d->length; }
 
+uint32_t Packet::interfaceIndex() const { return d->interfaceIndex; }
+
+void Packet::setInterfaceIndex(uint32_t index) { d->interfaceIndex = index; }
+
 std::unique_ptr<Buffer> Packet::payload() const {
   if (d->payload) {
     return d->payload->slice();
@@ -162,7 +183,8 @@ double Packet::confidence() const {
 
 v8::Local<v8::Value> Packet::timestamp() const {
   Isolate *isolate = Isolate::GetCurrent();
-  return v8::Date::New(isolate, (d->ts_sec * 1000.0) + (d->ts_nsec / 1000.0));
+  return v8::Date::New(isolate,
+                       (d->ts_sec * 1000.0) + (d->ts_nsec / 1000000.0));
 }
 
 v8::Local<v8::Object> Packet::payloadBuffer() const {
@@ -178,11 +200,10 @@ v8::Local<v8::Object> Packet::payloadBuffer() const {
 }
 
 void Packet::addLayer(const std::shared_ptr<Layer> &layer) {
-  d->layers[layer->ns()] = layer;
+  d->layers[layer->nsAtom()] = layer;
 }
 
-const std::unordered_map<std::string, std::shared_ptr<Layer>> &
-Packet::layers() const {
+const std::unordered_map<Atom, std::shared_ptr<Layer>> &Packet::layers() const {
   return d->layers;
 }
 
@@ -191,7 +212,7 @@ v8::Local<v8::Object> Packet::layersObject() const {
   v8::Local<v8::Object> obj = v8::Object::New(isolate);
   for (const auto &pair : d->layers) {
     obj->Set(
-        v8pp::to_v8(isolate, pair.first),
+        v8pp::to_v8(isolate, pair.first.str()),
         v8pp::class_<Layer>::reference_external(isolate, pair.second.get()));
   }
   return obj;
@@ -203,6 +224,7 @@ std::unique_ptr<Packet> Packet::shallowClone() {
   pkt->d->ts_sec = d->ts_sec;
   pkt->d->ts_nsec = d->ts_nsec;
   pkt->d->length = d->length;
+  pkt->d->interfaceIndex = d->interfaceIndex;
   pkt->d->vpacket = d->vpacket;
   if (d->payload) {
     pkt->d->payload = d->payload->slice();
@@ -1,6 +1,7 @@
 #ifndef PACKET_HPP
 #define PACKET_HPP
 
+#include "atom.hpp"
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -16,7 +17,8 @@ class Packet {
 public:
   Packet(v8::Local<v8::Object> option);
   Packet(std::unique_ptr<Layer> layer);
-  Packet(const struct pcap_pkthdr *h, const uint8_t *bytes);
+  Packet(const struct pcap_pkthdr *h, const uint8_t *bytes, bool nanosecond);
+  Packet(std::unique_ptr<Buffer> payload, uint32_t length);
   ~Packet();
   Packet(const Packet &) = delete;
   Packet &operator=(const Packet &) = delete;
@@ -26,7 +28,10 @@ public:
 
   uint32_t ts_sec() const;
   uint32_t ts_nsec() const;
+  void setTimestamp(uint32_t sec, uint32_t nsec);
   uint32_t length() const;
+  uint32_t interfaceIndex() const;
+  void setInterfaceIndex(uint32_t index);
   bool vpacket() const;
   std::string summary() const;
 
@@ -40,7 +45,7 @@ public:
   v8::Local<v8::Object> payloadBuffer() const;
 
   void addLayer(const std::shared_ptr<Layer> &layer);
-  const std::unordered_map<std::string, std::shared_ptr<Layer>> &layers() const;
+  const std::unordered_map<Atom, std::shared_ptr<Layer>> &layers() const;
   v8::Local<v8::Object> layersObject() const;
 
   std::unique_ptr<Packet> shallowClone();
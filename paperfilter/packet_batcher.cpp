@@ -0,0 +1,35 @@
+#include "packet_batcher.hpp"
+#include "packet.hpp"
+#include <algorithm>
+
+PacketBatcher::PacketBatcher(const Callback &cb, size_t size, int timeout)
+    : cb(cb), size(std::max(size, static_cast<size_t>(1))),
+      timeout(std::max(timeout, 0)) {
+  packets.reserve(this->size);
+}
+
+PacketBatcher::~PacketBatcher() { flush(); }
+
+void PacketBatcher::push(std::unique_ptr<Packet> pkt) {
+  if (packets.empty())
+    firstTime = std::chrono::steady_clock::now();
+  packets.push_back(std::move(pkt));
+  if (packets.size() >= size)
+    flush();
+}
+
+void PacketBatcher::poll() {
+  if (!packets.empty() &&
+      std::chrono::steady_clock::now() - firstTime >= timeout)
+    flush();
+}
+
+void PacketBatcher::flush() {
+  if (packets.empty())
+    return;
+  std::vector<std::unique_ptr<Packet>> batch;
+  batch.reserve(size);
+  batch.swap(packets);
+  if (cb)
+    cb(std::move(batch));
+}
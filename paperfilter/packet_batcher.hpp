@@ -0,0 +1,32 @@
+#ifndef PACKET_BATCHER_HPP
+#define PACKET_BATCHER_HPP
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class Packet;
+
+class PacketBatcher {
+public:
+  typedef std::function<void(std::vector<std::unique_ptr<Packet>>)> Callback;
+
+public:
+  PacketBatcher(const Callback &cb, size_t size, int timeout);
+  ~PacketBatcher();
+  PacketBatcher(const PacketBatcher &) = delete;
+  PacketBatcher &operator=(const PacketBatcher &) = delete;
+  void push(std::unique_ptr<Packet> pkt);
+  void poll();
+  void flush();
+
+private:
+  Callback cb;
+  size_t size;
+  std::chrono::milliseconds timeout;
+  std::chrono::steady_clock::time_point firstTime;
+  std::vector<std::unique_ptr<Packet>> packets;
+};
+
+#endif
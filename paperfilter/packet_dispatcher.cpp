@@ -1,63 +1,414 @@
 #include "packet_dispatcher.hpp"
 #include "stream_chunk.hpp"
 #include "dissector_thread.hpp"
+#include "flow_hash.hpp"
+#include "layer.hpp"
+#include "buffer.hpp"
 #include "packet.hpp"
+#include "work_deque.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 
+namespace {
+const size_t queueCapacity = 1 << 18;
+const size_t inboxCapacity = 1 << 16;
+const size_t dissectorBatch = 512;
+
+uint64_t timestamp(const Packet &pkt) {
+  return static_cast<uint64_t>(pkt.ts_sec()) * 1000000000ull + pkt.ts_nsec();
+}
+}
+
+DissectorSharedContext::DissectorSharedContext()
+    : queue(queueCapacity, dissectorBatch), flowAffinity(false) {}
+
+DissectorSharedContext::~DissectorSharedContext() {}
+
+uint32_t DissectorSharedContext::queued() const {
+  uint32_t size = queue.size();
+  for (const auto &inbox : inboxes) {
+    size += inbox->size();
+  }
+  return size;
+}
+
 class PacketDispatcher::Private {
 public:
   Private(const std::shared_ptr<Context> &ctx);
+  ~Private();
+  void dispatch(std::vector<std::unique_ptr<Packet>> packets);
+  void storeRaw(std::vector<std::unique_ptr<Packet>> packets);
+  void route(std::vector<std::unique_ptr<Packet>> packets);
+  void updateLimits();
+  void push(std::unique_ptr<Packet> pkt);
+  bool release(bool all);
+  bool reordering() const;
+  void updateHighWater(uint32_t size);
+
+public:
+  struct Pending {
+    std::chrono::steady_clock::time_point arrival;
+    std::unique_ptr<Packet> pkt;
+  };
 
 public:
   std::shared_ptr<DissectorSharedContext> dissCtx;
   std::vector<std::unique_ptr<DissectorThread>> dissectorThreads;
-  uint32_t packetSeq = 0;
+  std::atomic<uint32_t> packetSeq;
+  std::atomic<uint32_t> queueHighWater;
+
+  std::atomic<int> policy;
+  std::atomic<uint32_t> packetLimit;
+  std::atomic<uint32_t> sampleRate;
+  std::atomic<uint64_t> sampleCounter;
+  std::atomic<uint64_t> blocked;
+  std::atomic<uint64_t> dropped;
+  std::atomic<uint64_t> raw;
+  std::atomic<uint64_t> sampled;
+  std::atomic<uint32_t> roundRobin;
+
+  // Captured packets are held here, ordered by (timestamp, arrival), for up to
+  // reorderWindow so that streams from several interfaces are merged before
+  // they get their sequence numbers.
+  // Only this path takes a lock; with no window packets go straight into the
+  // lock-free queue.
+  std::mutex mutex;
+  std::map<std::pair<uint64_t, uint64_t>, Pending> reorderQueue;
+  std::atomic<uint32_t> reorderSize;
+  std::atomic<int> reorderWindowMs;
+  std::chrono::milliseconds reorderWindow;
+  uint64_t reorderCounter = 0;
+  uint64_t newestTimestamp = 0;
+  std::thread reorderThread;
+  std::condition_variable reorderCond;
+  bool closed = false;
 };
 
 PacketDispatcher::Private::Private(const std::shared_ptr<Context> &ctx)
-    : dissCtx(std::make_shared<DissectorSharedContext>()) {
+    : dissCtx(std::make_shared<DissectorSharedContext>()), packetSeq(0),
+      queueHighWater(0), policy(OverloadOption::POLICY_BLOCK),
+      packetLimit(dissCtx->queue.capacity()), sampleRate(1), sampleCounter(0),
+      blocked(0), dropped(0), raw(0), sampled(0), roundRobin(0), reorderSize(0),
+      reorderWindowMs(0), reorderWindow(0) {
 
   dissCtx->config = ctx->config;
   dissCtx->dissectors = ctx->dissectors;
+  dissCtx->nativeDissectors = ctx->nativeDissectors;
+  dissCtx->startupSnapshot = ctx->startupSnapshot;
   dissCtx->packetCb = ctx->packetCb;
   dissCtx->streamsCb = ctx->streamsCb;
   dissCtx->logCb = ctx->logCb;
   for (int i = 0; i < ctx->threads; ++i) {
-    dissectorThreads.emplace_back(new DissectorThread(dissCtx));
+    dissCtx->deques.emplace_back(new WorkDeque());
+    dissCtx->inboxes.emplace_back(
+        new PacketQueue(inboxCapacity, dissectorBatch));
+  }
+  for (int i = 0; i < ctx->threads; ++i) {
+    dissectorThreads.emplace_back(new DissectorThread(dissCtx, i));
+  }
+}
+
+PacketDispatcher::Private::~Private() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+  }
+  // Producers waiting for room give up instead of waiting for dissector
+  // threads that are about to stop.
+  dissCtx->queue.close();
+  for (const auto &inbox : dissCtx->inboxes)
+    inbox->close();
+  reorderCond.notify_all();
+  if (reorderThread.joinable())
+    reorderThread.join();
+}
+
+void PacketDispatcher::Private::dispatch(
+    std::vector<std::unique_ptr<Packet>> packets) {
+  const uint32_t limit = packetLimit;
+  const uint32_t size = dissCtx->queued();
+  const size_t room = size < limit ? limit - size : 0;
+  const auto policy = static_cast<OverloadOption::Policy>(this->policy.load());
+
+  // Packets past the bound are dropped before they get a sequence number,
+  // so the store never waits for a gap. Packets that already have one, such
+  // as those analyzed again after a reset, are never dropped or sampled;
+  // they wait for room, or are stored raw under the raw policy.
+  if (packets.size() > room) {
+    const uint32_t rate = sampleRate;
+    for (size_t i = room; i < packets.size(); ++i) {
+      const bool sequenced = packets[i]->seq() != 0;
+      if (policy == OverloadOption::POLICY_BLOCK ||
+          (sequenced && policy != OverloadOption::POLICY_RAW)) {
+        ++blocked;
+      } else if (policy == OverloadOption::POLICY_DROP) {
+        packets[i].reset();
+        ++dropped;
+      } else if (policy == OverloadOption::POLICY_SAMPLE) {
+        if (sampleCounter++ % rate != 0) {
+          packets[i].reset();
+          ++sampled;
+        }
+      }
+    }
+  }
+
+  // Sequence numbers for the whole batch are reserved at once, and the
+  // batch goes into the queue with a single claim.
+  uint32_t fresh = 0;
+  for (const auto &pkt : packets) {
+    if (pkt && pkt->seq() == 0)
+      ++fresh;
+  }
+  uint32_t seq = packetSeq.fetch_add(fresh);
+  std::vector<std::unique_ptr<Packet>> queued;
+  std::vector<std::unique_ptr<Packet>> skipped;
+  queued.reserve(packets.size());
+  for (size_t i = 0; i < packets.size(); ++i) {
+    std::unique_ptr<Packet> &pkt = packets[i];
+    if (!pkt)
+      continue;
+    if (pkt->seq() == 0)
+      pkt->setSeq(++seq);
+    if (policy == OverloadOption::POLICY_RAW && i >= room) {
+      skipped.push_back(std::move(pkt));
+    } else {
+      queued.push_back(std::move(pkt));
+    }
+  }
+
+  if (!queued.empty()) {
+    if (dissCtx->flowAffinity) {
+      route(std::move(queued));
+    } else {
+      dissCtx->queue.push(std::move(queued));
+    }
+    updateHighWater(dissCtx->queued() + reorderSize);
+  }
+  if (!skipped.empty())
+    storeRaw(std::move(skipped));
+}
+
+void PacketDispatcher::Private::route(
+    std::vector<std::unique_ptr<Packet>> packets) {
+  const size_t threads = dissCtx->inboxes.size();
+  std::vector<std::vector<std::unique_ptr<Packet>>> batches(threads);
+  for (auto &pkt : packets) {
+    uint32_t hash = 0;
+    std::unique_ptr<Buffer> payload = pkt->payload();
+    if (!payload ||
+        !FlowHash::hash(reinterpret_cast<const uint8_t *>(payload->data()),
+                        payload->length(), &hash)) {
+      hash = roundRobin++;
+    }
+    batches[hash % threads].push_back(std::move(pkt));
+  }
+
+  for (size_t i = 0; i < threads; ++i) {
+    if (batches[i].empty())
+      continue;
+    PacketQueue &inbox = *dissCtx->inboxes[i];
+    inbox.push(std::move(batches[i]));
+    // Idle threads wait on their own inboxes, so they have to be told when
+    // a peer falls behind.
+    if (inbox.size() > DissectorSharedContext::inboxBacklog) {
+      for (size_t j = 0; j < threads; ++j) {
+        if (j != i)
+          dissCtx->inboxes[j]->wake(1);
+      }
+    }
+  }
+}
+
+void PacketDispatcher::Private::updateLimits() {
+  // Only the block policy lets producers wait on the queues; the others
+  // never push past the bound themselves.
+  const bool block = policy == OverloadOption::POLICY_BLOCK;
+  dissCtx->queue.setLimit(block ? packetLimit.load()
+                                : dissCtx->queue.capacity());
+  for (const auto &inbox : dissCtx->inboxes) {
+    inbox->setLimit(block ? packetLimit / dissCtx->inboxes.size()
+                          : inbox->capacity());
+  }
+}
+
+void PacketDispatcher::Private::storeRaw(
+    std::vector<std::unique_ptr<Packet>> packets) {
+  raw += packets.size();
+  std::vector<std::shared_ptr<Packet>> stored;
+  stored.reserve(packets.size());
+  for (auto &pkt : packets) {
+    std::shared_ptr<Packet> shared(std::move(pkt));
+    for (const auto &pair : shared->layers()) {
+      pair.second->setPacket(shared);
+    }
+    // The stream dispatcher orders chunks by packet sequence, so every
+    // packet has to be accounted for there even without any streams.
+    if (dissCtx->streamsCb)
+      dissCtx->streamsCb(shared->seq(),
+                         std::vector<std::unique_ptr<StreamChunk>>());
+    stored.push_back(std::move(shared));
+  }
+  if (dissCtx->packetCb)
+    dissCtx->packetCb(stored);
+}
+
+bool PacketDispatcher::Private::reordering() const {
+  return reorderWindowMs > 0 || reorderSize > 0;
+}
+
+void PacketDispatcher::Private::updateHighWater(uint32_t size) {
+  uint32_t highWater = queueHighWater.load(std::memory_order_relaxed);
+  while (size > highWater &&
+         !queueHighWater.compare_exchange_weak(highWater, size,
+                                               std::memory_order_relaxed)) {
   }
 }
 
+void PacketDispatcher::Private::push(std::unique_ptr<Packet> pkt) {
+  if (reorderWindow.count() <= 0 || pkt->seq() != 0 || pkt->vpacket()) {
+    std::vector<std::unique_ptr<Packet>> packets;
+    packets.push_back(std::move(pkt));
+    dispatch(std::move(packets));
+    return;
+  }
+  uint64_t ts = timestamp(*pkt);
+  newestTimestamp = std::max(newestTimestamp, ts);
+  Pending pending;
+  pending.arrival = std::chrono::steady_clock::now();
+  pending.pkt = std::move(pkt);
+  reorderQueue.emplace(std::make_pair(ts, ++reorderCounter),
+                       std::move(pending));
+  reorderSize = reorderQueue.size();
+  updateHighWater(dissCtx->queue.size() + reorderSize);
+}
+
+bool PacketDispatcher::Private::release(bool all) {
+  const auto now = std::chrono::steady_clock::now();
+  const uint64_t window =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(reorderWindow)
+          .count();
+  std::vector<std::unique_ptr<Packet>> packets;
+  while (!reorderQueue.empty()) {
+    auto it = reorderQueue.begin();
+    if (!all && it->first.first + window > newestTimestamp &&
+        now - it->second.arrival < reorderWindow)
+      break;
+    packets.push_back(std::move(it->second.pkt));
+    reorderQueue.erase(it);
+  }
+  reorderSize = reorderQueue.size();
+  if (packets.empty())
+    return false;
+  dispatch(std::move(packets));
+  return true;
+}
+
 PacketDispatcher::PacketDispatcher(const std::shared_ptr<Context> &ctx)
     : d(std::make_shared<Private>(ctx)) {}
 
 PacketDispatcher::~PacketDispatcher() {}
 
 void PacketDispatcher::analyze(std::unique_ptr<Packet> packet) {
-  {
-    std::lock_guard<std::mutex> lock(d->dissCtx->mutex);
-    if (packet->seq() == 0) {
-      packet->setSeq(++d->packetSeq);
-    }
-    d->dissCtx->queue.push(std::move(packet));
+  if (!d->reordering()) {
+    std::vector<std::unique_ptr<Packet>> packets;
+    packets.push_back(std::move(packet));
+    d->dispatch(std::move(packets));
+    return;
   }
-  d->dissCtx->cond.notify_all();
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->push(std::move(packet));
+  d->release(false);
 }
 
 void PacketDispatcher::analyze(std::vector<std::unique_ptr<Packet>> packets) {
-  {
-    std::lock_guard<std::mutex> lock(d->dissCtx->mutex);
-    for (auto &pkt : packets) {
-      if (pkt->seq() == 0) {
-        pkt->setSeq(++d->packetSeq);
+  if (!d->reordering()) {
+    d->dispatch(std::move(packets));
+    return;
+  }
+  std::lock_guard<std::mutex> lock(d->mutex);
+  for (auto &pkt : packets) {
+    d->push(std::move(pkt));
+  }
+  d->release(false);
+}
+
+void PacketDispatcher::setReorderWindow(int ms) {
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->reorderWindow = std::chrono::milliseconds(std::max(ms, 0));
+  d->reorderWindowMs = d->reorderWindow.count();
+  if (d->reorderWindow.count() == 0) {
+    d->release(true);
+  } else if (!d->reorderThread.joinable()) {
+    // Flushes packets that have waited for the whole window when no newer
+    // packet arrives to push them out.
+    Private *p = d.get();
+    d->reorderThread = std::thread([p]() {
+      std::unique_lock<std::mutex> lock(p->mutex);
+      while (!p->closed) {
+        const auto wait = p->reorderWindow.count() > 0
+                              ? p->reorderWindow
+                              : std::chrono::milliseconds(100);
+        p->reorderCond.wait_for(lock, wait);
+        p->release(false);
       }
-      d->dissCtx->queue.push(std::move(pkt));
-    }
+    });
   }
-  d->dissCtx->cond.notify_all();
 }
 
+int PacketDispatcher::reorderWindow() const { return d->reorderWindowMs; }
+
 uint32_t PacketDispatcher::queueSize() const {
-  std::lock_guard<std::mutex> lock(d->dissCtx->mutex);
-  return d->dissCtx->queue.size();
+  return d->dissCtx->queued() + d->reorderSize;
+}
+
+uint32_t PacketDispatcher::queueHighWater() const {
+  return std::max(d->queueHighWater.load(), queueSize());
+}
+
+uint32_t PacketDispatcher::takeQueueHighWater() {
+  return d->queueHighWater.exchange(queueSize());
+}
+
+void PacketDispatcher::setFlowAffinity(bool affinity) {
+  if (d->dissCtx->inboxes.size() < 2)
+    affinity = false;
+  d->dissCtx->flowAffinity = affinity;
+  // Waiting threads switch over to the queue they should now sleep on.
+  d->dissCtx->queue.wakeAll();
+  for (const auto &inbox : d->dissCtx->inboxes) {
+    inbox->wakeAll();
+  }
+}
+
+bool PacketDispatcher::flowAffinity() const {
+  return d->dissCtx->flowAffinity;
+}
+
+uint64_t PacketDispatcher::shedPackets() const {
+  return d->dropped + d->raw + d->sampled;
+}
+
+void PacketDispatcher::setOverloadOption(const OverloadOption &option) {
+  d->policy = option.policy;
+  d->sampleRate = std::max(option.sampleRate, 1u);
+  d->packetLimit =
+      std::max<uint32_t>(1, std::min<size_t>(option.packetLimit,
+                                             d->dissCtx->queue.capacity()));
+  d->updateLimits();
+}
+
+OverloadStats PacketDispatcher::overloadStats() const {
+  OverloadStats stats;
+  stats.blocked = d->blocked;
+  stats.dropped = d->dropped;
+  stats.raw = d->raw;
+  stats.sampled = d->sampled;
+  return stats;
 }
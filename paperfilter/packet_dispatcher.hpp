@@ -2,28 +2,50 @@
 #define PACKET_DISPATCHER_HPP
 
 #include "dissector.hpp"
+#include "overload.hpp"
+#include "packet_queue.hpp"
+#include <atomic>
 #include <functional>
 #include <memory>
-#include <vector>
-#include <queue>
 #include <mutex>
-#include <condition_variable>
+#include <vector>
 
 class StreamChunk;
+struct NativeDissector;
+class NamespaceMatcher;
+class WorkDeque;
 class Layer;
 class Packet;
 struct LogMessage;
 
 struct DissectorSharedContext {
+  DissectorSharedContext();
+  ~DissectorSharedContext();
+
   std::string config;
   std::vector<Dissector> dissectors;
+  std::vector<const NativeDissector *> nativeDissectors;
+  bool startupSnapshot = false;
   std::function<void(const std::vector<std::shared_ptr<Packet>> &)> packetCb;
   std::function<void(uint32_t, std::vector<std::unique_ptr<StreamChunk>>)>
       streamsCb;
   std::function<void(const LogMessage &)> logCb;
-  std::queue<std::unique_ptr<Packet>> queue;
-  std::mutex mutex;
-  std::condition_variable cond;
+
+  // Built by the first thread that has loaded the dissectors.
+  std::once_flag matcherFlag;
+  std::shared_ptr<const NamespaceMatcher> matcher;
+
+  PacketQueue queue;
+  std::vector<std::unique_ptr<WorkDeque>> deques;
+
+  // With flow affinity every packet of a flow goes to the same thread's
+  // inbox. Other threads only help out once an inbox holds more than
+  // inboxBacklog packets.
+  static const size_t inboxBacklog = 1024;
+  std::atomic<bool> flowAffinity;
+  std::vector<std::unique_ptr<PacketQueue>> inboxes;
+
+  uint32_t queued() const;
 };
 
 class PacketDispatcher {
@@ -32,6 +54,8 @@ public:
     int threads;
     std::string config;
     std::vector<Dissector> dissectors;
+    std::vector<const NativeDissector *> nativeDissectors;
+    bool startupSnapshot = false;
     std::function<void(const std::vector<std::shared_ptr<Packet>> &)> packetCb;
     std::function<void(uint32_t, std::vector<std::unique_ptr<StreamChunk>>)>
         streamsCb;
@@ -45,7 +69,16 @@ public:
   PacketDispatcher &operator=(const PacketDispatcher &) = delete;
   void analyze(std::unique_ptr<Packet> packet);
   void analyze(std::vector<std::unique_ptr<Packet>> packets);
+  void setReorderWindow(int ms);
+  int reorderWindow() const;
   uint32_t queueSize() const;
+  uint32_t queueHighWater() const;
+  uint32_t takeQueueHighWater();
+  uint64_t shedPackets() const;
+  void setFlowAffinity(bool affinity);
+  bool flowAffinity() const;
+  void setOverloadOption(const OverloadOption &option);
+  OverloadStats overloadStats() const;
 
 private:
   class Private;
@@ -0,0 +1,228 @@
+#include "packet_exporter.hpp"
+#include "buffer.hpp"
+#include "filtered_packet_store.hpp"
+#include "packet.hpp"
+#include "packet_store.hpp"
+#include "pcapng.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+const uint32_t chunkSize = 1024;
+const size_t flushSize = 4 << 20;
+const std::chrono::milliseconds progressInterval(100);
+
+const uint32_t pcapMagicNsec = 0xa1b23c4d;
+}
+
+class PacketExporter::Private {
+public:
+  Private(const std::shared_ptr<Context> &ctx);
+  ~Private();
+  void run();
+  bool write(const std::shared_ptr<Packet> &pkt);
+  void writeHeader();
+  void addInterfaces(uint32_t index);
+  bool flush();
+  void report(bool force);
+
+  template <class T> void append(T value) {
+    const char *p = reinterpret_cast<const char *>(&value);
+    buffer.insert(buffer.end(), p, p + sizeof(value));
+  }
+  void append(const char *data, size_t length) {
+    buffer.insert(buffer.end(), data, data + length);
+  }
+  char *reserve(size_t length) {
+    buffer.resize(buffer.size() + length);
+    return &buffer[buffer.size() - length];
+  }
+
+public:
+  std::shared_ptr<Context> ctx;
+  std::string path;
+  FILE *file = nullptr;
+  std::vector<char> buffer;
+  uint32_t interfaces = 0;
+  Progress progress;
+  std::chrono::steady_clock::time_point lastReport;
+  std::thread thread;
+  std::atomic<bool> closed;
+  std::atomic<bool> finished;
+};
+
+PacketExporter::Private::Private(const std::shared_ptr<Context> &ctx)
+    : ctx(ctx), closed(false), finished(false) {}
+
+PacketExporter::Private::~Private() {
+  closed = true;
+  if (thread.joinable())
+    thread.join();
+  if (file)
+    fclose(file);
+}
+
+void PacketExporter::Private::run() {
+  writeHeader();
+
+  if (ctx->filtered) {
+    // The filtered list only grows at the end, so a snapshot of its sequence
+    // numbers gives an exact total up front.
+    std::vector<uint32_t> seqs;
+    uint32_t size = ctx->filtered->size();
+    if (size > 0)
+      seqs = ctx->filtered->get(0, size - 1);
+    auto begin = std::lower_bound(seqs.begin(), seqs.end(), ctx->start);
+    auto end = std::upper_bound(begin, seqs.end(), ctx->end);
+    progress.total = std::distance(begin, end);
+
+    for (auto it = begin; it != end && !closed; ++it) {
+      const std::shared_ptr<Packet> &pkt = ctx->store->get(*it);
+      if (pkt && !write(pkt))
+        break;
+    }
+  } else {
+    uint32_t last = std::min(ctx->end, ctx->store->maxSeq());
+    if (ctx->start <= last)
+      progress.total = last - ctx->start + 1;
+
+    bool ok = true;
+    for (uint32_t seq = ctx->start; ok && !closed && seq <= last;) {
+      uint32_t chunkEnd = std::min(last, seq + chunkSize - 1);
+      for (const auto &pkt : ctx->store->get(seq, chunkEnd)) {
+        if (closed || !(ok = write(pkt)))
+          break;
+      }
+      if (chunkEnd == last)
+        break;
+      seq = chunkEnd + 1;
+    }
+  }
+
+  if (progress.error.empty() && !flush())
+    progress.error = path + ": " + strerror(errno);
+  if (fclose(file) != 0 && progress.error.empty())
+    progress.error = path + ": " + strerror(errno);
+  file = nullptr;
+  if (closed && progress.error.empty())
+    progress.error = "export was cancelled";
+
+  progress.done = true;
+  report(true);
+  finished = true;
+}
+
+void PacketExporter::Private::writeHeader() {
+  if (ctx->format == FORMAT_PCAPNG) {
+    Pcapng::writeSHB(reserve(Pcapng::shbSize));
+  } else {
+    append(pcapMagicNsec);
+    append<uint16_t>(2);
+    append<uint16_t>(4);
+    append<int32_t>(0);
+    append<uint32_t>(0);
+    append<uint32_t>(ctx->snaplen);
+    append<uint32_t>(ctx->linkType);
+  }
+}
+
+void PacketExporter::Private::addInterfaces(uint32_t index) {
+  // IDBs may appear anywhere in a section before the first packet that
+  // refers to them. Interface IDs are kept equal to the session's interface
+  // indices.
+  for (; interfaces <= index; ++interfaces) {
+    Pcapng::writeIDB(reserve(Pcapng::idbSize), ctx->linkType, ctx->snaplen);
+  }
+}
+
+bool PacketExporter::Private::write(const std::shared_ptr<Packet> &pkt) {
+  if (pkt->seq() < ctx->start || pkt->seq() > ctx->end)
+    return true;
+
+  std::unique_ptr<Buffer> payload = pkt->payload();
+  uint32_t caplen = payload ? payload->length() : 0;
+  const char *data = payload ? payload->data() : nullptr;
+
+  if (ctx->format == FORMAT_PCAPNG) {
+    uint32_t id = pkt->interfaceIndex();
+    addInterfaces(id);
+    uint64_t ts = pkt->ts_sec() * 1000000000ull + pkt->ts_nsec();
+    Pcapng::writeEPB(reserve(Pcapng::epbSize(caplen)), id, ts, caplen,
+                     pkt->length(), data);
+  } else {
+    append<uint32_t>(pkt->ts_sec());
+    append<uint32_t>(pkt->ts_nsec());
+    append(caplen);
+    append<uint32_t>(pkt->length());
+    append(data, caplen);
+  }
+
+  ++progress.packets;
+  if (buffer.size() >= flushSize && !flush()) {
+    progress.error = path + ": " + strerror(errno);
+    return false;
+  }
+  report(false);
+  return true;
+}
+
+bool PacketExporter::Private::flush() {
+  if (buffer.empty())
+    return true;
+  size_t written = fwrite(buffer.data(), 1, buffer.size(), file);
+  progress.bytes += written;
+  bool ok = written == buffer.size();
+  buffer.clear();
+  return ok;
+}
+
+void PacketExporter::Private::report(bool force) {
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - lastReport < progressInterval)
+    return;
+  lastReport = now;
+  if (ctx->progressCb)
+    ctx->progressCb(progress);
+}
+
+PacketExporter::PacketExporter(const std::shared_ptr<Context> &ctx)
+    : d(new Private(ctx)) {}
+
+PacketExporter::~PacketExporter() {}
+
+bool PacketExporter::open(const std::string &path, std::string *error) {
+  if (!d->ctx->store) {
+    error->assign("no packets to export");
+    return false;
+  }
+  d->path = path;
+  d->file = fopen(path.c_str(), "wb");
+  if (!d->file) {
+    error->assign(path + ": " + strerror(errno));
+    return false;
+  }
+  // Writes are already batched into flushSize chunks.
+  setvbuf(d->file, nullptr, _IONBF, 0);
+  d->buffer.reserve(flushSize + 64 * 1024);
+  return true;
+}
+
+void PacketExporter::start() {
+  if (!d->file || d->thread.joinable())
+    return;
+  d->thread = std::thread([this]() { d->run(); });
+}
+
+void PacketExporter::stop() {
+  d->closed = true;
+  if (d->thread.joinable())
+    d->thread.join();
+}
+
+bool PacketExporter::finished() const { return d->finished; }
@@ -0,0 +1,54 @@
+#ifndef PACKET_EXPORTER_HPP
+#define PACKET_EXPORTER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+class PacketStore;
+class FilteredPacketStore;
+
+class PacketExporter {
+public:
+  enum Format { FORMAT_PCAP, FORMAT_PCAPNG };
+
+  struct Progress {
+    uint32_t packets = 0;
+    uint32_t total = 0;
+    uint64_t bytes = 0;
+    bool done = false;
+    std::string error;
+  };
+
+  struct Context {
+    Format format = FORMAT_PCAP;
+    int linkType = 1; // DLT_EN10MB
+    uint32_t snaplen = 65535;
+
+    // Only packets with start <= seq <= end are written.
+    uint32_t start = 1;
+    uint32_t end = UINT32_MAX;
+
+    PacketStore *store = nullptr;
+    std::shared_ptr<const FilteredPacketStore> filtered;
+    std::function<void(const Progress &)> progressCb;
+  };
+
+public:
+  PacketExporter(const std::shared_ptr<Context> &ctx);
+  ~PacketExporter();
+  PacketExporter(const PacketExporter &) = delete;
+  PacketExporter &operator=(const PacketExporter &) = delete;
+
+  bool open(const std::string &path, std::string *error);
+  void start();
+  void stop();
+  bool finished() const;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
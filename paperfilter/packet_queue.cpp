@@ -0,0 +1,278 @@
+#include "packet_queue.hpp"
+#include "packet.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace {
+// Sleeping side of the queue. A waiter announces itself with prepareWait(),
+// re-checks the ring and then calls wait() with the returned key; a notify()
+// issued in between bumps the epoch so the wakeup cannot be lost.
+class EventCount {
+public:
+  EventCount() : epoch(0), waiters(0) {}
+
+  uint64_t prepareWait() {
+    waiters.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch.load();
+  }
+
+  void cancelWait() { waiters.fetch_sub(1); }
+
+  void wait(uint64_t key) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (epoch.load() == key)
+      cond.wait(lock);
+    waiters.fetch_sub(1);
+  }
+
+  void notify(size_t count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int sleeping = waiters.load();
+    if (sleeping == 0)
+      return;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      epoch.fetch_add(1);
+    }
+    if (count >= static_cast<size_t>(sleeping)) {
+      cond.notify_all();
+    } else {
+      for (size_t i = 0; i < count; ++i)
+        cond.notify_one();
+    }
+  }
+
+  void notifyAll() { notify(SIZE_MAX); }
+
+private:
+  std::atomic<uint64_t> epoch;
+  std::atomic<int> waiters;
+  std::mutex mutex;
+  std::condition_variable cond;
+};
+
+struct Cell {
+  std::atomic<uint64_t> seq;
+  Packet *pkt = nullptr;
+};
+
+size_t roundUp(size_t n) {
+  size_t size = 2;
+  while (size < n)
+    size <<= 1;
+  return size;
+}
+}
+
+class PacketQueue::Private {
+public:
+  Private(size_t capacity, size_t batchSize);
+  ~Private();
+  size_t tryPush(std::unique_ptr<Packet> *packets, size_t count);
+  size_t tryPop(std::vector<std::unique_ptr<Packet>> *packets, size_t max);
+  void pushAll(std::unique_ptr<Packet> *packets, size_t count);
+  void notifyConsumers(size_t count);
+
+public:
+  const size_t batchSize;
+  const uint64_t capacity;
+  const uint64_t mask;
+  std::unique_ptr<Cell[]> cells;
+  std::atomic<uint64_t> limit;
+  std::atomic<bool> closed;
+
+  // Positions only ever grow; a cell's seq tells which lap and which side
+  // (free or filled) it is on. The padding keeps producers and consumers off
+  // each other's cache line.
+  std::atomic<uint64_t> enqueuePos;
+  char padding[64];
+  std::atomic<uint64_t> dequeuePos;
+
+  EventCount notEmpty;
+  EventCount notFull;
+};
+
+PacketQueue::Private::Private(size_t capacity, size_t batchSize)
+    : batchSize(std::max<size_t>(batchSize, 1)), capacity(roundUp(capacity)),
+      mask(this->capacity - 1), cells(new Cell[this->capacity]),
+      limit(this->capacity), closed(false), enqueuePos(0), dequeuePos(0) {
+  for (uint64_t i = 0; i < this->capacity; ++i)
+    cells[i].seq.store(i, std::memory_order_relaxed);
+}
+
+PacketQueue::Private::~Private() {
+  std::vector<std::unique_ptr<Packet>> packets;
+  while (tryPop(&packets, batchSize) > 0)
+    packets.clear();
+}
+
+size_t PacketQueue::Private::tryPush(std::unique_ptr<Packet> *packets,
+                                     size_t count) {
+  uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+  while (true) {
+    uint64_t used = pos - std::min(pos, dequeuePos.load());
+    uint64_t max = limit.load(std::memory_order_relaxed);
+    if (used >= max)
+      return 0;
+    const size_t room = std::min<uint64_t>(count, max - used);
+
+    // Claim the longest run of free cells, then publish them one by one.
+    size_t n = 0;
+    while (n < room) {
+      const Cell &cell = cells[(pos + n) & mask];
+      if (cell.seq.load(std::memory_order_acquire) != pos + n)
+        break;
+      ++n;
+    }
+    if (n == 0) {
+      int64_t diff =
+          static_cast<int64_t>(
+              cells[pos & mask].seq.load(std::memory_order_acquire)) -
+          static_cast<int64_t>(pos);
+      if (diff < 0)
+        return 0;
+      pos = enqueuePos.load(std::memory_order_relaxed);
+      continue;
+    }
+    if (enqueuePos.compare_exchange_weak(pos, pos + n,
+                                         std::memory_order_relaxed)) {
+      for (size_t i = 0; i < n; ++i) {
+        Cell &cell = cells[(pos + i) & mask];
+        cell.pkt = packets[i].release();
+        cell.seq.store(pos + i + 1, std::memory_order_release);
+      }
+      return n;
+    }
+  }
+}
+
+size_t PacketQueue::Private::tryPop(
+    std::vector<std::unique_ptr<Packet>> *packets, size_t max) {
+  uint64_t pos = dequeuePos.load(std::memory_order_relaxed);
+  while (true) {
+    size_t n = 0;
+    while (n < max) {
+      const Cell &cell = cells[(pos + n) & mask];
+      if (cell.seq.load(std::memory_order_acquire) != pos + n + 1)
+        break;
+      ++n;
+    }
+    if (n == 0) {
+      int64_t diff =
+          static_cast<int64_t>(
+              cells[pos & mask].seq.load(std::memory_order_acquire)) -
+          static_cast<int64_t>(pos + 1);
+      if (diff < 0)
+        return 0;
+      pos = dequeuePos.load(std::memory_order_relaxed);
+      continue;
+    }
+    if (dequeuePos.compare_exchange_weak(pos, pos + n,
+                                         std::memory_order_relaxed)) {
+      for (size_t i = 0; i < n; ++i) {
+        Cell &cell = cells[(pos + i) & mask];
+        packets->emplace_back(cell.pkt);
+        cell.pkt = nullptr;
+        cell.seq.store(pos + i + capacity, std::memory_order_release);
+      }
+      return n;
+    }
+  }
+}
+
+void PacketQueue::Private::notifyConsumers(size_t count) {
+  // One consumer per batch; waking more would only have them race for the
+  // same cells.
+  notEmpty.notify((count + batchSize - 1) / batchSize);
+}
+
+void PacketQueue::Private::pushAll(std::unique_ptr<Packet> *packets,
+                                   size_t count) {
+  size_t offset = 0;
+  while (offset < count && !closed) {
+    size_t n = tryPush(packets + offset, count - offset);
+    if (n == 0) {
+      uint64_t key = notFull.prepareWait();
+      n = tryPush(packets + offset, count - offset);
+      if (n == 0) {
+        // close() sets the flag before it notifies, so either it is seen
+        // here or the key is already stale.
+        if (closed) {
+          notFull.cancelWait();
+          return;
+        }
+        notFull.wait(key);
+        continue;
+      }
+      notFull.cancelWait();
+    }
+    notifyConsumers(n);
+    offset += n;
+  }
+}
+
+PacketQueue::PacketQueue(size_t capacity, size_t batchSize)
+    : d(new Private(capacity, batchSize)) {}
+
+PacketQueue::~PacketQueue() {}
+
+void PacketQueue::push(std::unique_ptr<Packet> pkt) { d->pushAll(&pkt, 1); }
+
+void PacketQueue::push(std::vector<std::unique_ptr<Packet>> packets) {
+  d->pushAll(packets.data(), packets.size());
+}
+
+size_t PacketQueue::tryPop(std::vector<std::unique_ptr<Packet>> *packets,
+                           size_t max) {
+  size_t n = d->tryPop(packets, max);
+  if (n > 0)
+    d->notFull.notify(1);
+  return n;
+}
+
+size_t PacketQueue::pop(std::vector<std::unique_ptr<Packet>> *packets,
+                        size_t max, const std::function<bool()> &cancelled) {
+  while (true) {
+    size_t n = tryPop(packets, max);
+    if (n > 0 || cancelled())
+      return n;
+
+    uint64_t key = d->notEmpty.prepareWait();
+    n = tryPop(packets, max);
+    if (n > 0 || cancelled()) {
+      d->notEmpty.cancelWait();
+      return n;
+    }
+    d->notEmpty.wait(key);
+  }
+}
+
+void PacketQueue::wake(size_t consumers) { d->notEmpty.notify(consumers); }
+
+void PacketQueue::wakeAll() {
+  d->notEmpty.notifyAll();
+  d->notFull.notifyAll();
+}
+
+void PacketQueue::close() {
+  d->closed = true;
+  wakeAll();
+}
+
+void PacketQueue::setLimit(size_t limit) {
+  d->limit = std::max<uint64_t>(1, std::min<uint64_t>(limit, d->capacity));
+  d->notFull.notifyAll();
+}
+
+size_t PacketQueue::limit() const { return d->limit; }
+
+size_t PacketQueue::capacity() const { return d->capacity; }
+
+uint32_t PacketQueue::size() const {
+  uint64_t head = d->dequeuePos.load(std::memory_order_relaxed);
+  uint64_t tail = d->enqueuePos.load(std::memory_order_relaxed);
+  return tail - head;
+}
@@ -0,0 +1,40 @@
+#ifndef PACKET_QUEUE_HPP
+#define PACKET_QUEUE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class Packet;
+
+// Bounded multi-producer multi-consumer ring of packets. Slots are claimed in
+// batches with a single CAS, and threads only take a lock when they actually
+// have to sleep. Producers block once the queue holds limit() packets, until
+// close() is called; packets pushed after that are discarded.
+class PacketQueue {
+public:
+  PacketQueue(size_t capacity, size_t batchSize);
+  ~PacketQueue();
+  PacketQueue(const PacketQueue &) = delete;
+  PacketQueue &operator=(const PacketQueue &) = delete;
+
+  void push(std::unique_ptr<Packet> pkt);
+  void push(std::vector<std::unique_ptr<Packet>> packets);
+  size_t tryPop(std::vector<std::unique_ptr<Packet>> *packets, size_t max);
+  size_t pop(std::vector<std::unique_ptr<Packet>> *packets, size_t max,
+             const std::function<bool()> &cancelled);
+  void wake(size_t consumers);
+  void wakeAll();
+  void close();
+  void setLimit(size_t limit);
+  size_t limit() const;
+  size_t capacity() const;
+  uint32_t size() const;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
@@ -0,0 +1,329 @@
+#include "packet_replayer.hpp"
+#include "buffer.hpp"
+#include "log_message.hpp"
+#include "packet.hpp"
+#include "pcap_file_reader.hpp"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <pcap.h>
+#include <random>
+#include <thread>
+
+namespace {
+const size_t batchSize = 1024;
+const size_t maxSamples = 36000;
+const std::chrono::milliseconds maxSleep(50);
+
+uint16_t load16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+
+void store16(uint8_t *p, uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v & 0xff;
+}
+
+// Incremental checksum update as in RFC 1624.
+void adjustChecksum(uint8_t *csum, uint16_t from, uint16_t to) {
+  uint32_t sum = static_cast<uint16_t>(~load16(csum));
+  sum += static_cast<uint16_t>(~from);
+  sum += to;
+  sum = (sum & 0xffff) + (sum >> 16);
+  sum = (sum & 0xffff) + (sum >> 16);
+  store16(csum, ~sum);
+}
+
+// XORs the low 32 bits of both IP addresses with salt, fixing up the IP,
+// TCP and UDP checksums. Each flow maps to a new flow consistently, so
+// stream reassembly still works within a loop.
+void rewriteFlow(uint8_t *data, size_t length, uint32_t salt) {
+  if (length < 14)
+    return;
+  size_t offset = 14;
+  uint16_t type = load16(data + 12);
+  while ((type == 0x8100 || type == 0x88a8) && length >= offset + 4) {
+    type = load16(data + offset + 2);
+    offset += 4;
+  }
+
+  uint8_t *ip = data + offset;
+  const uint16_t mask[2] = {static_cast<uint16_t>(salt >> 16),
+                            static_cast<uint16_t>(salt & 0xffff)};
+  uint8_t *addrs[2] = {nullptr, nullptr};
+  uint8_t *ipChecksum = nullptr;
+  uint8_t *transport = nullptr;
+  uint8_t protocol = 0;
+
+  if (type == 0x0800 && length >= offset + 20) {
+    size_t ihl = (ip[0] & 0x0f) * 4;
+    if (ihl < 20 || length < offset + ihl)
+      return;
+    addrs[0] = ip + 12;
+    addrs[1] = ip + 16;
+    ipChecksum = ip + 10;
+    protocol = ip[9];
+    if ((load16(ip + 6) & 0x1fff) == 0)
+      transport = ip + ihl;
+  } else if (type == 0x86dd && length >= offset + 40) {
+    addrs[0] = ip + 20;
+    addrs[1] = ip + 36;
+    protocol = ip[6];
+    transport = ip + 40;
+  } else {
+    return;
+  }
+
+  uint8_t *l4Checksum = nullptr;
+  if (transport) {
+    size_t l4 = transport - data;
+    if (protocol == 6 && length >= l4 + 18) {
+      l4Checksum = transport + 16;
+    } else if (protocol == 17 && length >= l4 + 8 &&
+               load16(transport + 6) != 0) {
+      l4Checksum = transport + 6;
+    }
+  }
+
+  for (uint8_t *addr : addrs) {
+    for (int i = 0; i < 2; ++i) {
+      uint16_t from = load16(addr + i * 2);
+      uint16_t to = from ^ mask[i];
+      store16(addr + i * 2, to);
+      if (ipChecksum)
+        adjustChecksum(ipChecksum, from, to);
+      if (l4Checksum)
+        adjustChecksum(l4Checksum, from, to);
+    }
+  }
+  if (l4Checksum && protocol == 17 && load16(l4Checksum) == 0)
+    store16(l4Checksum, 0xffff);
+}
+}
+
+class PacketReplayer::Private {
+public:
+  Private(const std::shared_ptr<Context> &ctx);
+  ~Private();
+  void run();
+  void pace(std::unique_ptr<Packet> pkt);
+  void waitUntil(std::chrono::steady_clock::time_point due);
+  void flush();
+  void sample(std::chrono::steady_clock::time_point now);
+  void log(LogMessage::Level level, const std::string &message);
+
+public:
+  std::shared_ptr<Context> ctx;
+  std::string path;
+  std::unique_ptr<PcapFileReader> reader;
+  std::thread thread;
+  std::atomic<bool> closed;
+  std::atomic<bool> running;
+
+  std::mt19937 rng;
+  uint32_t salt = 0;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point loopStart;
+  std::chrono::steady_clock::time_point nextSample;
+  bool hasFirst = false;
+  uint64_t firstTs = 0;
+  std::vector<std::unique_ptr<Packet>> pending;
+  std::vector<uint8_t> scratch;
+
+  std::atomic<uint64_t> packets;
+  std::atomic<uint64_t> bytes;
+  std::atomic<uint32_t> loops;
+  mutable std::mutex sampleMutex;
+  std::deque<Sample> samples;
+};
+
+PacketReplayer::Private::Private(const std::shared_ptr<Context> &ctx)
+    : ctx(ctx), closed(false), running(false), rng(std::random_device()()),
+      packets(0), bytes(0), loops(0) {}
+
+PacketReplayer::Private::~Private() {}
+
+void PacketReplayer::Private::log(LogMessage::Level level,
+                                  const std::string &message) {
+  if (!ctx->logCb)
+    return;
+  LogMessage msg;
+  msg.level = level;
+  msg.message = path + ": " + message;
+  msg.domain = "replay";
+  ctx->logCb(msg);
+}
+
+void PacketReplayer::Private::run() {
+  start = std::chrono::steady_clock::now();
+  nextSample = start;
+  for (uint32_t loop = 0; !closed && (ctx->loops == 0 || loop < ctx->loops);
+       ++loop) {
+    // Reopening rewinds the reader and clears a stop left over from a
+    // previous run.
+    std::string error;
+    if (!reader->open(path, &error)) {
+      log(LogMessage::LEVEL_ERROR, error);
+      break;
+    }
+    // A stop() that landed before open() was undone by it.
+    if (closed)
+      break;
+    salt = ctx->randomizeFlows ? rng() : 0;
+    loopStart = std::chrono::steady_clock::now();
+    hasFirst = false;
+    reader->read();
+    flush();
+    ++loops;
+  }
+  flush();
+  sample(std::chrono::steady_clock::now());
+  running = false;
+}
+
+void PacketReplayer::Private::pace(std::unique_ptr<Packet> pkt) {
+  if (closed)
+    return;
+
+  using namespace std::chrono;
+  const uint64_t ts = pkt->ts_sec() * 1000000000ull + pkt->ts_nsec();
+  if (!hasFirst) {
+    firstTs = ts;
+    hasFirst = true;
+  }
+
+  if (ctx->pps > 0) {
+    waitUntil(start + nanoseconds(static_cast<int64_t>(packets / ctx->pps *
+                                                       1e9)));
+  } else if (ctx->bps > 0) {
+    waitUntil(start + nanoseconds(static_cast<int64_t>(bytes * 8 / ctx->bps *
+                                                       1e9)));
+  } else if (ctx->speed > 0 && ts > firstTs) {
+    waitUntil(loopStart +
+              nanoseconds(static_cast<int64_t>((ts - firstTs) / ctx->speed)));
+  }
+
+  if (salt) {
+    std::unique_ptr<Buffer> payload = pkt->payload();
+    if (payload) {
+      const uint8_t *data = reinterpret_cast<const uint8_t *>(payload->data());
+      scratch.assign(data, data + payload->length());
+      rewriteFlow(scratch.data(), scratch.size(), salt);
+      pcap_pkthdr h;
+      h.ts.tv_sec = 0;
+      h.ts.tv_usec = 0;
+      h.caplen = scratch.size();
+      h.len = pkt->length();
+      std::unique_ptr<Packet> copy(new Packet(&h, scratch.data(), true));
+      copy->setInterfaceIndex(pkt->interfaceIndex());
+      pkt = std::move(copy);
+    }
+  }
+
+  // Replayed packets look like a live capture.
+  const nanoseconds now =
+      duration_cast<nanoseconds>(system_clock::now().time_since_epoch());
+  pkt->setTimestamp(duration_cast<seconds>(now).count(),
+                    now.count() % 1000000000);
+
+  ++packets;
+  bytes += pkt->length();
+  pending.push_back(std::move(pkt));
+  if (pending.size() >= batchSize)
+    flush();
+  sample(steady_clock::now());
+}
+
+void PacketReplayer::Private::waitUntil(
+    std::chrono::steady_clock::time_point due) {
+  auto now = std::chrono::steady_clock::now();
+  if (due <= now)
+    return;
+  flush();
+  while (!closed && (now = std::chrono::steady_clock::now()) < due) {
+    sample(now);
+    std::this_thread::sleep_for(
+        std::min<std::chrono::steady_clock::duration>(due - now, maxSleep));
+  }
+}
+
+void PacketReplayer::Private::flush() {
+  if (pending.empty())
+    return;
+  if (ctx->packetsCb)
+    ctx->packetsCb(std::move(pending));
+  pending.clear();
+}
+
+void PacketReplayer::Private::sample(
+    std::chrono::steady_clock::time_point now) {
+  if (now < nextSample)
+    return;
+  nextSample = now + std::chrono::milliseconds(ctx->sampleInterval);
+
+  Sample s;
+  s.time = std::chrono::duration_cast<std::chrono::milliseconds>(now - start)
+               .count();
+  s.queue = ctx->queueCb ? ctx->queueCb() : 0;
+  s.packets = packets;
+  std::lock_guard<std::mutex> lock(sampleMutex);
+  samples.push_back(s);
+  if (samples.size() > maxSamples)
+    samples.pop_front();
+}
+
+PacketReplayer::PacketReplayer(const std::shared_ptr<Context> &ctx)
+    : d(new Private(ctx)) {}
+
+PacketReplayer::~PacketReplayer() { stop(); }
+
+bool PacketReplayer::open(const std::string &path, std::string *error) {
+  stop();
+  d->path = path;
+
+  // The reader runs on the replay thread; it is not throttled by the
+  // dispatcher backlog, so overload shows up in the queue samples.
+  auto readerCtx = std::make_shared<PcapFileReader::Context>();
+  readerCtx->logCb = d->ctx->logCb;
+  readerCtx->packetsCb = [this](std::vector<std::unique_ptr<Packet>> packets) {
+    for (auto &pkt : packets) {
+      d->pace(std::move(pkt));
+    }
+  };
+  d->reader.reset(new PcapFileReader(readerCtx));
+  return d->reader->open(path, error);
+}
+
+void PacketReplayer::start() {
+  stop();
+  if (!d->reader)
+    return;
+  d->closed = false;
+  d->running = true;
+  d->packets = 0;
+  d->bytes = 0;
+  d->loops = 0;
+  {
+    std::lock_guard<std::mutex> lock(d->sampleMutex);
+    d->samples.clear();
+  }
+  d->thread = std::thread([this]() { d->run(); });
+}
+
+void PacketReplayer::stop() {
+  d->closed = true;
+  if (d->reader)
+    d->reader->stop();
+  if (d->thread.joinable())
+    d->thread.join();
+}
+
+PacketReplayer::Stats PacketReplayer::stats() const {
+  Stats stats;
+  stats.packets = d->packets;
+  stats.bytes = d->bytes;
+  stats.loops = d->loops;
+  stats.running = d->running;
+  std::lock_guard<std::mutex> lock(d->sampleMutex);
+  stats.samples.assign(d->samples.begin(), d->samples.end());
+  return stats;
+}
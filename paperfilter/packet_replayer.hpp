@@ -0,0 +1,60 @@
+#ifndef PACKET_REPLAYER_HPP
+#define PACKET_REPLAYER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Packet;
+struct LogMessage;
+
+class PacketReplayer {
+public:
+  struct Context {
+    // Pacing: pps or bps when set, otherwise the capture timing scaled by
+    // speed. A speed of 0 sends as fast as possible.
+    double speed = 1.0;
+    double pps = 0;
+    double bps = 0;
+    uint32_t loops = 1; // 0 to repeat until stopped
+    bool randomizeFlows = false;
+    uint32_t sampleInterval = 100; // ms
+
+    std::function<void(std::vector<std::unique_ptr<Packet>>)> packetsCb;
+    std::function<void(const LogMessage &)> logCb;
+    std::function<uint32_t()> queueCb;
+  };
+
+  struct Sample {
+    uint32_t time = 0; // ms since start
+    uint32_t queue = 0;
+    uint64_t packets = 0;
+  };
+
+  struct Stats {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint32_t loops = 0;
+    bool running = false;
+    std::vector<Sample> samples;
+  };
+
+public:
+  PacketReplayer(const std::shared_ptr<Context> &ctx);
+  ~PacketReplayer();
+  PacketReplayer(const PacketReplayer &) = delete;
+  PacketReplayer &operator=(const PacketReplayer &) = delete;
+
+  bool open(const std::string &path, std::string *error);
+  void start();
+  void stop();
+  Stats stats() const;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "payload_arena.hpp"
+#include "buffer.hpp"
+#include <cstring>
+
+PayloadArena::PayloadArena(size_t slabSize) : slabSize(slabSize) {}
+
+PayloadArena::~PayloadArena() {}
+
+std::unique_ptr<Buffer> PayloadArena::copy(const char *data, size_t length) {
+  // Large payloads would waste most of a slab; give them their own storage.
+  if (length > slabSize / 4) {
+    auto source = std::make_shared<std::vector<char>>(data, data + length);
+    return std::unique_ptr<Buffer>(new Buffer(source));
+  }
+
+  if (!slab || slabSize - offset < length) {
+    slab = std::make_shared<std::vector<char>>(slabSize);
+    offset = 0;
+  }
+
+  size_t start = offset;
+  std::memcpy(slab->data() + start, data, length);
+  offset += length;
+  return std::unique_ptr<Buffer>(new Buffer(slab, start, start + length));
+}
+
+PayloadArena &PayloadArena::local() {
+  static thread_local PayloadArena arena;
+  return arena;
+}
@@ -0,0 +1,25 @@
+#ifndef PAYLOAD_ARENA_HPP
+#define PAYLOAD_ARENA_HPP
+
+#include <memory>
+#include <vector>
+
+class Buffer;
+
+class PayloadArena {
+public:
+  explicit PayloadArena(size_t slabSize = 1 << 20);
+  ~PayloadArena();
+  PayloadArena(const PayloadArena &) = delete;
+  PayloadArena &operator=(const PayloadArena &) = delete;
+  std::unique_ptr<Buffer> copy(const char *data, size_t length);
+
+  static PayloadArena &local();
+
+private:
+  size_t slabSize;
+  size_t offset = 0;
+  std::shared_ptr<std::vector<char>> slab;
+};
+
+#endif
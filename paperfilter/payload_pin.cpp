@@ -0,0 +1,73 @@
+#include "payload_pin.hpp"
+#include <mutex>
+#include <uv.h>
+#include <vector>
+
+using namespace v8;
+
+namespace {
+// Handles dropped by other threads, reset on the main thread.
+struct Releaser {
+  std::mutex mutex;
+  std::vector<Persistent<ArrayBuffer> *> handles;
+  uv_async_t async;
+};
+
+Releaser *releaser() {
+  // Leaked so that packets can still drop their pins during exit. The first
+  // call comes from pin() on the main thread.
+  static Releaser *releaser = []() {
+    Releaser *r = new Releaser();
+    r->async.data = r;
+    uv_async_init(uv_default_loop(), &r->async, [](uv_async_t *handle) {
+      Releaser *r = static_cast<Releaser *>(handle->data);
+      std::vector<Persistent<ArrayBuffer> *> handles;
+      {
+        std::lock_guard<std::mutex> lock(r->mutex);
+        handles.swap(r->handles);
+      }
+      for (Persistent<ArrayBuffer> *handle : handles) {
+        handle->Reset();
+        delete handle;
+      }
+    });
+    uv_unref(reinterpret_cast<uv_handle_t *>(&r->async));
+    return r;
+  }();
+  return releaser;
+}
+}
+
+namespace PayloadPin {
+std::shared_ptr<const char> pin(v8::Local<v8::Value> buffer, size_t *length) {
+  if (!buffer->IsArrayBufferView())
+    return std::shared_ptr<const char>();
+
+  Isolate *isolate = Isolate::GetCurrent();
+  Local<ArrayBufferView> view = buffer.As<ArrayBufferView>();
+  Local<ArrayBuffer> arrayBuffer = view->Buffer();
+
+  // An externalized store may be freed by its owner at any time.
+  if (arrayBuffer->IsExternal())
+    return std::shared_ptr<const char>();
+
+  // The store belongs to the isolate's allocator, which is Blink's in the
+  // renderer, so it is kept alive through the ArrayBuffer rather than
+  // externalized and freed here.
+  Releaser *r = releaser();
+  Persistent<ArrayBuffer> *handle =
+      new Persistent<ArrayBuffer>(isolate, arrayBuffer);
+  std::shared_ptr<const char> store(
+      static_cast<const char *>(arrayBuffer->GetContents().Data()),
+      [r, handle](const char *) {
+        {
+          std::lock_guard<std::mutex> lock(r->mutex);
+          r->handles.push_back(handle);
+        }
+        uv_async_send(&r->async);
+      });
+
+  *length = view->ByteLength();
+  return std::shared_ptr<const char>(store, store.get() + view->ByteOffset());
+}
+}
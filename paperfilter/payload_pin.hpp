@@ -0,0 +1,16 @@
+#ifndef PAYLOAD_PIN_HPP
+#define PAYLOAD_PIN_HPP
+
+#include <memory>
+#include <v8.h>
+
+namespace PayloadPin {
+// Returns the bytes of a Node Buffer without copying them. The returned
+// pointers hold a strong handle to the Buffer's ArrayBuffer, which is released
+// on the main thread once the last of them is gone; the caller must not modify
+// the Buffer afterwards. Returns an empty pointer if the store is owned
+// elsewhere. Must be called on the main thread.
+std::shared_ptr<const char> pin(v8::Local<v8::Value> buffer, size_t *length);
+}
+
+#endif
@@ -0,0 +1,223 @@
+#include "pcap_file_reader.hpp"
+#include "log_message.hpp"
+#include "packet.hpp"
+#include "pcap_parser.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <pcap.h>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const size_t batchSize = 1024;
+const uint32_t maxBacklog = 1 << 16;
+
+class MappedFile {
+public:
+  MappedFile() {}
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool open(const std::string &path, std::string *error) {
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                       OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER fileSize;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+      error->assign("failed to open " + path);
+      return false;
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+    if (size == 0)
+      return true;
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping)
+      data = static_cast<const uint8_t *>(
+          MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+      error->assign(path + ": " + strerror(errno));
+      return false;
+    }
+    size = st.st_size;
+    if (size == 0)
+      return true;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      data = static_cast<const uint8_t *>(map);
+      madvise(map, size, MADV_SEQUENTIAL);
+    }
+#endif
+    if (!data) {
+      error->assign("failed to map " + path);
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+#ifdef _WIN32
+    if (data)
+      UnmapViewOfFile(data);
+    if (mapping)
+      CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (data)
+      munmap(const_cast<uint8_t *>(data), size);
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+#endif
+    data = nullptr;
+    size = 0;
+  }
+
+public:
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+
+private:
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#else
+  int fd = -1;
+#endif
+};
+}
+
+class PcapFileReader::Private {
+public:
+  Private(const std::shared_ptr<Context> &ctx);
+  void log(LogMessage::Level level, const std::string &message);
+  bool push(const PcapParser::Record &record);
+  void flush();
+
+public:
+  std::shared_ptr<Context> ctx;
+  MappedFile file;
+  std::string path;
+  std::thread thread;
+  std::atomic<bool> closed;
+  std::atomic<bool> finished;
+
+  PcapParser parser;
+  size_t headerLength = 0;
+  std::vector<std::unique_ptr<Packet>> packets;
+};
+
+PcapFileReader::Private::Private(const std::shared_ptr<Context> &ctx)
+    : ctx(ctx), closed(false), finished(false) {}
+
+void PcapFileReader::Private::log(LogMessage::Level level,
+                                  const std::string &message) {
+  if (ctx->logCb) {
+    LogMessage msg;
+    msg.level = level;
+    msg.message = path + ": " + message;
+    msg.domain = "pcap-file";
+    ctx->logCb(msg);
+  }
+}
+
+bool PcapFileReader::Private::push(const PcapParser::Record &record) {
+  pcap_pkthdr h;
+  h.ts.tv_sec = record.sec;
+  h.ts.tv_usec = record.nsec;
+  h.caplen = record.caplen;
+  h.len = record.length;
+  std::unique_ptr<Packet> pkt(new Packet(&h, record.data, true));
+  pkt->setInterfaceIndex(record.interfaceIndex);
+  packets.push_back(std::move(pkt));
+  if (packets.size() >= batchSize)
+    flush();
+  return !closed;
+}
+
+void PcapFileReader::Private::flush() {
+  if (packets.empty())
+    return;
+
+  // Reading from the page cache is far faster than dissection; keep the
+  // dispatcher queue bounded instead of materializing the whole file.
+  if (ctx->backlogCb) {
+    while (!closed && ctx->backlogCb() > maxBacklog) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  }
+
+  if (ctx->packetsCb)
+    ctx->packetsCb(std::move(packets));
+  packets.clear();
+}
+
+PcapFileReader::PcapFileReader(const std::shared_ptr<Context> &ctx)
+    : d(new Private(ctx)) {}
+
+PcapFileReader::~PcapFileReader() { stop(); }
+
+bool PcapFileReader::open(const std::string &path, std::string *error) {
+  stop();
+  d->file.close();
+  d->path = path;
+  if (!d->file.open(path, error))
+    return false;
+
+  d->parser.reset();
+  if (!d->parser.readHeader(d->file.data, d->file.size, &d->headerLength,
+                            error))
+    return false;
+  d->closed = false;
+  d->finished = false;
+  return true;
+}
+
+void PcapFileReader::start() {
+  stop();
+  d->closed = false;
+  d->finished = false;
+  d->thread = std::thread([this]() { read(); });
+}
+
+void PcapFileReader::read() {
+  if (!d->file.data)
+    return;
+  std::string error;
+  const size_t size = d->file.size - d->headerLength;
+  size_t consumed = d->parser.parse(
+      d->file.data + d->headerLength, size,
+      [this](const PcapParser::Record &record) { return d->push(record); },
+      &error);
+  if (!error.empty()) {
+    d->log(LogMessage::LEVEL_ERROR, error);
+  } else if (!d->closed && consumed < size) {
+    d->log(LogMessage::LEVEL_WARN, "truncated record");
+  }
+  d->flush();
+  d->finished = true;
+}
+
+void PcapFileReader::stop() {
+  d->closed = true;
+  if (d->thread.joinable())
+    d->thread.join();
+}
+
+bool PcapFileReader::finished() const { return d->finished; }
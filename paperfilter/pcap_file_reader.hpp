@@ -0,0 +1,37 @@
+#ifndef PCAP_FILE_READER_HPP
+#define PCAP_FILE_READER_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Packet;
+struct LogMessage;
+
+class PcapFileReader {
+public:
+  struct Context {
+    std::function<void(std::vector<std::unique_ptr<Packet>>)> packetsCb;
+    std::function<void(const LogMessage &)> logCb;
+    std::function<uint32_t()> backlogCb;
+  };
+
+public:
+  PcapFileReader(const std::shared_ptr<Context> &ctx);
+  ~PcapFileReader();
+  PcapFileReader(const PcapFileReader &) = delete;
+  PcapFileReader &operator=(const PcapFileReader &) = delete;
+
+  bool open(const std::string &path, std::string *error);
+  void start();
+  void read();
+  void stop();
+  bool finished() const;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
@@ -0,0 +1,325 @@
+#include "pcap_parser.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+const uint32_t magicMicro = 0xa1b2c3d4;
+const uint32_t magicNano = 0xa1b23c4d;
+const uint32_t blockSHB = 0x0a0d0d0a;
+const uint32_t blockIDB = 0x00000001;
+const uint32_t blockPB = 0x00000002;
+const uint32_t blockSPB = 0x00000003;
+const uint32_t blockEPB = 0x00000006;
+const uint32_t byteOrderMagic = 0x1a2b3c4d;
+// Larger records are taken as corruption rather than waited for.
+const uint32_t maxCaplen = 262144;
+
+uint16_t swap16(uint16_t v) { return (v >> 8) | (v << 8); }
+
+uint32_t swap32(uint32_t v) {
+  return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+uint64_t swap64(uint64_t v) {
+  return (static_cast<uint64_t>(swap32(v)) << 32) | swap32(v >> 32);
+}
+
+struct Interface {
+  uint32_t snaplen = 0;
+  // Timestamp resolution: units per second as 10^n or 2^n.
+  bool binary = false;
+  int exponent = 6;
+  int64_t offset = 0;
+};
+}
+
+class PcapParser::Private {
+public:
+  uint32_t u16(const uint8_t *p) const;
+  uint32_t u32(const uint8_t *p) const;
+  uint64_t u64(const uint8_t *p) const;
+  size_t parsePcap(const uint8_t *data, size_t size, const RecordCallback &cb,
+                   std::string *error);
+  size_t parsePcapng(const uint8_t *data, size_t size,
+                     const RecordCallback &cb, std::string *error);
+  void readInterface(const uint8_t *body, size_t length);
+  bool blockPacket(uint32_t ifindex, uint64_t ts, uint32_t caplen,
+                   uint32_t len, const uint8_t *data, const RecordCallback &cb);
+
+public:
+  bool ng = false;
+  bool swapped = false;
+  bool nanosecond = false;
+  uint32_t snaplen = 0;
+  std::vector<Interface> interfaces;
+  uint32_t interfaceBase = 0;
+};
+
+uint32_t PcapParser::Private::u16(const uint8_t *p) const {
+  uint16_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return swapped ? swap16(v) : v;
+}
+
+uint32_t PcapParser::Private::u32(const uint8_t *p) const {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return swapped ? swap32(v) : v;
+}
+
+uint64_t PcapParser::Private::u64(const uint8_t *p) const {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return swapped ? swap64(v) : v;
+}
+
+size_t PcapParser::Private::parsePcap(const uint8_t *data, size_t size,
+                                      const RecordCallback &cb,
+                                      std::string *error) {
+  size_t offset = 0;
+  while (size - offset >= 16) {
+    const uint8_t *h = data + offset;
+    Record record;
+    record.sec = u32(h);
+    uint32_t frac = u32(h + 4);
+    record.nsec = nanosecond ? frac : frac * 1000;
+    record.caplen = u32(h + 8);
+    record.length = u32(h + 12);
+    if (record.caplen > maxCaplen || (snaplen > 0 && record.caplen > snaplen)) {
+      error->assign("broken record: caplen " + std::to_string(record.caplen));
+      break;
+    }
+    if (size - offset - 16 < record.caplen)
+      break;
+    record.data = h + 16;
+    offset += 16 + record.caplen;
+    if (!cb(record))
+      break;
+  }
+  return offset;
+}
+
+void PcapParser::Private::readInterface(const uint8_t *body, size_t length) {
+  Interface ifs;
+  if (length >= 8)
+    ifs.snaplen = u32(body + 4);
+
+  size_t offset = 8;
+  while (offset + 4 <= length) {
+    uint32_t code = u16(body + offset);
+    uint32_t optlen = u16(body + offset + 2);
+    offset += 4;
+    if (code == 0 || offset + optlen > length)
+      break;
+    if (code == 9 && optlen >= 1) {
+      uint8_t resol = body[offset];
+      ifs.binary = resol & 0x80;
+      ifs.exponent = resol & 0x7f;
+    } else if (code == 14 && optlen >= 8) {
+      // A single 64-bit value in section byte order, unlike the packet
+      // timestamps which are split into high and low words.
+      ifs.offset = static_cast<int64_t>(u64(body + offset));
+    }
+    offset += (optlen + 3) & ~3u;
+  }
+  interfaces.push_back(ifs);
+}
+
+bool PcapParser::Private::blockPacket(uint32_t ifindex, uint64_t ts,
+                                      uint32_t caplen, uint32_t len,
+                                      const uint8_t *data,
+                                      const RecordCallback &cb) {
+  uint64_t sec = 0;
+  uint64_t nsec = 0;
+  if (ifindex < interfaces.size()) {
+    const Interface &ifs = interfaces[ifindex];
+    if (ifs.binary) {
+      int n = std::min(ifs.exponent, 63);
+      sec = ts >> n;
+      uint64_t frac = ts & ((uint64_t(1) << n) - 1);
+      nsec = static_cast<uint64_t>(std::ldexp(static_cast<double>(frac), -n) *
+                                   1e9);
+    } else {
+      uint64_t units = 1;
+      for (int i = 0; i < ifs.exponent && i < 19; ++i)
+        units *= 10;
+      sec = ts / units;
+      uint64_t frac = ts % units;
+      if (ifs.exponent <= 9) {
+        for (int i = ifs.exponent; i < 9; ++i)
+          frac *= 10;
+      } else {
+        for (int i = 9; i < ifs.exponent && i < 19; ++i)
+          frac /= 10;
+      }
+      nsec = frac;
+    }
+    sec += ifs.offset;
+  }
+  Record record;
+  record.sec = static_cast<uint32_t>(sec);
+  record.nsec = static_cast<uint32_t>(nsec);
+  record.caplen = caplen;
+  record.length = len;
+  record.interfaceIndex = interfaceBase + ifindex;
+  record.data = data;
+  return cb(record);
+}
+
+size_t PcapParser::Private::parsePcapng(const uint8_t *data, size_t size,
+                                        const RecordCallback &cb,
+                                        std::string *error) {
+  size_t offset = 0;
+  while (size - offset >= 12) {
+    const uint8_t *block = data + offset;
+
+    uint32_t type;
+    std::memcpy(&type, block, sizeof(type));
+    if (type == blockSHB) {
+      // Each section may have its own byte order and interface list.
+      uint32_t magic;
+      std::memcpy(&magic, block + 8, sizeof(magic));
+      if (magic == byteOrderMagic) {
+        swapped = false;
+      } else if (magic == swap32(byteOrderMagic)) {
+        swapped = true;
+      } else {
+        error->assign("broken section header");
+        break;
+      }
+    } else {
+      type = u32(block);
+    }
+
+    uint32_t length = u32(block + 4);
+    if (length < 12 || length % 4 != 0) {
+      error->assign("broken block header");
+      break;
+    }
+    if (length > size - offset)
+      break;
+    const uint8_t *body = block + 8;
+    size_t bodyLength = length - 12;
+    offset += length;
+
+    bool next = true;
+    switch (type) {
+    case blockSHB:
+      interfaceBase += interfaces.size();
+      interfaces.clear();
+      break;
+    case blockIDB:
+      readInterface(body, bodyLength);
+      break;
+    case blockEPB:
+      if (bodyLength >= 20) {
+        uint32_t ifindex = u32(body);
+        uint64_t ts = (static_cast<uint64_t>(u32(body + 4)) << 32) |
+                      u32(body + 8);
+        uint32_t caplen = u32(body + 12);
+        uint32_t len = u32(body + 16);
+        if (caplen <= bodyLength - 20)
+          next = blockPacket(ifindex, ts, caplen, len, body + 20, cb);
+      }
+      break;
+    case blockPB:
+      if (bodyLength >= 20) {
+        uint32_t ifindex = u16(body);
+        uint64_t ts = (static_cast<uint64_t>(u32(body + 4)) << 32) |
+                      u32(body + 8);
+        uint32_t caplen = u32(body + 12);
+        uint32_t len = u32(body + 16);
+        if (caplen <= bodyLength - 20)
+          next = blockPacket(ifindex, ts, caplen, len, body + 20, cb);
+      }
+      break;
+    case blockSPB:
+      if (bodyLength >= 4 && !interfaces.empty()) {
+        Record record;
+        record.length = u32(body);
+        record.caplen = std::min<uint32_t>(record.length, bodyLength - 4);
+        if (interfaces[0].snaplen > 0)
+          record.caplen = std::min(record.caplen, interfaces[0].snaplen);
+        record.interfaceIndex = interfaceBase;
+        record.data = body + 4;
+        next = cb(record);
+      }
+      break;
+    default:
+      break;
+    }
+    if (!next)
+      break;
+  }
+  return offset;
+}
+
+PcapParser::PcapParser() : d(new Private()) {}
+
+PcapParser::~PcapParser() {}
+
+bool PcapParser::isHeader(const uint8_t *data, size_t size) {
+  if (size < 4)
+    return false;
+  uint32_t magic;
+  std::memcpy(&magic, data, sizeof(magic));
+  return magic == magicMicro || magic == swap32(magicMicro) ||
+         magic == magicNano || magic == swap32(magicNano) ||
+         magic == blockSHB;
+}
+
+bool PcapParser::readHeader(const uint8_t *data, size_t size,
+                            size_t *headerLength, std::string *error) {
+  if (size < 12) {
+    error->assign("too short file header");
+    return false;
+  }
+
+  uint32_t magic;
+  std::memcpy(&magic, data, sizeof(magic));
+
+  if (magic == blockSHB) {
+    // The section header is parsed as an ordinary block, which moves the
+    // interface ids past those of the previous section.
+    setFormat(true, false, false);
+    *headerLength = 0;
+    return true;
+  } else if (magic == magicMicro || magic == swap32(magicMicro)) {
+    setFormat(false, magic != magicMicro, false);
+  } else if (magic == magicNano || magic == swap32(magicNano)) {
+    setFormat(false, magic != magicNano, true);
+  } else {
+    error->assign("unknown file format");
+    return false;
+  }
+
+  if (size < 24) {
+    error->assign("too short global header");
+    return false;
+  }
+  d->interfaces.clear();
+  d->snaplen = d->u32(data + 16);
+  *headerLength = 24;
+  return true;
+}
+
+void PcapParser::reset() {
+  d->interfaces.clear();
+  d->interfaceBase = 0;
+  d->snaplen = 0;
+}
+
+void PcapParser::setFormat(bool ng, bool swapped, bool nanosecond) {
+  d->ng = ng;
+  d->swapped = swapped;
+  d->nanosecond = nanosecond;
+}
+
+size_t PcapParser::parse(const uint8_t *data, size_t size,
+                         const RecordCallback &cb, std::string *error) {
+  if (d->ng)
+    return d->parsePcapng(data, size, cb, error);
+  return d->parsePcap(data, size, cb, error);
+}
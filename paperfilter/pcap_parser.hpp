@@ -0,0 +1,43 @@
+#ifndef PCAP_PARSER_HPP
+#define PCAP_PARSER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Walks pcap records or pcapng blocks in memory. Section and interface state
+// is kept between calls, so a capture can be parsed in pieces.
+class PcapParser {
+public:
+  struct Record {
+    uint32_t sec = 0;
+    uint32_t nsec = 0;
+    uint32_t caplen = 0;
+    uint32_t length = 0;
+    uint32_t interfaceIndex = 0;
+    const uint8_t *data = nullptr;
+  };
+  typedef std::function<bool(const Record &)> RecordCallback;
+
+public:
+  PcapParser();
+  ~PcapParser();
+  PcapParser(const PcapParser &) = delete;
+  PcapParser &operator=(const PcapParser &) = delete;
+
+  static bool isHeader(const uint8_t *data, size_t size);
+  // Forgets the interfaces of earlier sections before a new stream.
+  void reset();
+  bool readHeader(const uint8_t *data, size_t size, size_t *headerLength,
+                  std::string *error);
+  void setFormat(bool ng, bool swapped, bool nanosecond);
+  size_t parse(const uint8_t *data, size_t size, const RecordCallback &cb,
+               std::string *error);
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
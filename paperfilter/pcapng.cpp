@@ -0,0 +1,62 @@
+#include "pcapng.hpp"
+#include <cstring>
+
+namespace {
+const uint32_t blockSHB = 0x0a0d0d0a;
+const uint32_t blockIDB = 0x00000001;
+const uint32_t blockEPB = 0x00000006;
+const uint32_t byteOrderMagic = 0x1a2b3c4d;
+const uint16_t optEnd = 0;
+const uint16_t optTsresol = 9;
+
+template <class T> char *put(char *dst, T value) {
+  memcpy(dst, &value, sizeof(value));
+  return dst + sizeof(value);
+}
+}
+
+namespace Pcapng {
+size_t epbSize(uint32_t caplen) { return 32 + ((caplen + 3) & ~3u); }
+
+void writeSHB(char *dst) {
+  dst = put(dst, blockSHB);
+  dst = put<uint32_t>(dst, shbSize);
+  dst = put(dst, byteOrderMagic);
+  dst = put<uint16_t>(dst, 1);
+  dst = put<uint16_t>(dst, 0);
+  dst = put<int64_t>(dst, -1);
+  put<uint32_t>(dst, shbSize);
+}
+
+void writeIDB(char *dst, int linkType, uint32_t snaplen) {
+  dst = put(dst, blockIDB);
+  dst = put<uint32_t>(dst, idbSize);
+  dst = put<uint16_t>(dst, linkType);
+  dst = put<uint16_t>(dst, 0);
+  dst = put(dst, snaplen);
+  dst = put(dst, optTsresol);
+  dst = put<uint16_t>(dst, 1);
+  dst = put<uint8_t>(dst, 9); // 10^-9
+  dst = put<uint8_t>(dst, 0);
+  dst = put<uint16_t>(dst, 0);
+  dst = put(dst, optEnd);
+  dst = put<uint16_t>(dst, 0);
+  put<uint32_t>(dst, idbSize);
+}
+
+void writeEPB(char *dst, uint32_t interfaceId, uint64_t ts, uint32_t caplen,
+              uint32_t length, const char *data) {
+  uint32_t size = epbSize(caplen);
+  dst = put(dst, blockEPB);
+  dst = put(dst, size);
+  dst = put(dst, interfaceId);
+  dst = put<uint32_t>(dst, ts >> 32);
+  dst = put<uint32_t>(dst, ts);
+  dst = put(dst, caplen);
+  dst = put(dst, length);
+  if (caplen > 0)
+    memcpy(dst, data, caplen);
+  memset(dst + caplen, 0, size - 32 - caplen);
+  put(dst + size - 32, size);
+}
+}
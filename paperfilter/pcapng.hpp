@@ -0,0 +1,20 @@
+#ifndef PCAPNG_HPP
+#define PCAPNG_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Writers for the pcapng blocks produced by paperfilter. All blocks are in
+// host byte order, and every interface uses nanosecond timestamps.
+namespace Pcapng {
+const size_t shbSize = 28;
+const size_t idbSize = 32;
+
+size_t epbSize(uint32_t caplen);
+void writeSHB(char *dst);
+void writeIDB(char *dst, int linkType, uint32_t snaplen);
+void writeEPB(char *dst, uint32_t interfaceId, uint64_t ts, uint32_t caplen,
+              uint32_t length, const char *data);
+}
+
+#endif
@@ -0,0 +1,547 @@
+#include "prefilter.hpp"
+#include <pcap.h>
+
+#ifndef BPF_MOD
+#define BPF_MOD 0x90
+#endif
+#ifndef BPF_XOR
+#define BPF_XOR 0xa0
+#endif
+#ifndef BPF_MEMWORDS
+#define BPF_MEMWORDS 16
+#endif
+
+namespace {
+enum Kind {
+  OP_RET_K,
+  OP_RET_A,
+  OP_LD_ABS,
+  OP_LD_IND,
+  OP_LD_LEN,
+  OP_LDX_LEN,
+  OP_LDX_MSH,
+  OP_LD_IMM,
+  OP_LDX_IMM,
+  OP_LD_MEM,
+  OP_LDX_MEM,
+  OP_ST,
+  OP_STX,
+  OP_JA,
+  OP_JEQ_K,
+  OP_JGT_K,
+  OP_JGE_K,
+  OP_JSET_K,
+  OP_JEQ_X,
+  OP_JGT_X,
+  OP_JGE_X,
+  OP_JSET_X,
+  OP_ALU_K,
+  OP_ALU_X,
+  OP_NEG,
+  OP_TAX,
+  OP_TXA,
+  OP_LD_ABS_JEQ,
+  OP_LD_ABS_JGT,
+  OP_LD_ABS_JGE,
+  OP_LD_ABS_JSET
+};
+
+inline bool load(const uint8_t *data, uint32_t caplen, uint64_t offset,
+                 uint32_t size, uint32_t *value) {
+  if (offset + size > caplen)
+    return false;
+  const uint8_t *p = data + offset;
+  switch (size) {
+  case 4:
+    *value = (static_cast<uint32_t>(p[0]) << 24) |
+             (static_cast<uint32_t>(p[1]) << 16) |
+             (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    break;
+  case 2:
+    *value = (static_cast<uint32_t>(p[0]) << 8) | p[1];
+    break;
+  default:
+    *value = p[0];
+  }
+  return true;
+}
+
+inline uint32_t loadSize(uint16_t code) {
+  switch (BPF_SIZE(code)) {
+  case BPF_W:
+    return 4;
+  case BPF_H:
+    return 2;
+  default:
+    return 1;
+  }
+}
+
+inline bool alu(uint8_t op, uint32_t *a, uint32_t v) {
+  switch (op) {
+  case BPF_ADD:
+    *a += v;
+    break;
+  case BPF_SUB:
+    *a -= v;
+    break;
+  case BPF_MUL:
+    *a *= v;
+    break;
+  case BPF_DIV:
+    if (v == 0)
+      return false;
+    *a /= v;
+    break;
+  case BPF_MOD:
+    if (v == 0)
+      return false;
+    *a %= v;
+    break;
+  case BPF_AND:
+    *a &= v;
+    break;
+  case BPF_OR:
+    *a |= v;
+    break;
+  case BPF_XOR:
+    *a ^= v;
+    break;
+  case BPF_LSH:
+    *a = v < 32 ? *a << v : 0;
+    break;
+  case BPF_RSH:
+    *a = v < 32 ? *a >> v : 0;
+    break;
+  default:
+    return false;
+  }
+  return true;
+}
+}
+
+Prefilter::Prefilter(const std::vector<Pcap::Instruction> &program, bool jit)
+    : program(program) {
+  if (jit)
+    compiled = decode();
+}
+
+Prefilter::~Prefilter() {}
+
+bool Prefilter::jit() const { return compiled; }
+
+bool Prefilter::match(const uint8_t *data, uint32_t caplen,
+                      uint32_t wirelen) const {
+  // An empty program accepts every packet.
+  if (program.empty())
+    return true;
+  if (wirelen < caplen)
+    wirelen = caplen;
+  return (compiled ? run(data, caplen, wirelen)
+                   : interpret(data, caplen, wirelen)) != 0;
+}
+
+uint32_t Prefilter::interpret(const uint8_t *data, uint32_t caplen,
+                              uint32_t wirelen) const {
+  uint32_t a = 0;
+  uint32_t x = 0;
+  uint32_t mem[BPF_MEMWORDS] = {0};
+
+  size_t pc = 0;
+  while (pc < program.size()) {
+    const Pcap::Instruction &insn = program[pc++];
+    const uint32_t k = insn.k;
+    switch (insn.code) {
+    case BPF_RET | BPF_K:
+      return k;
+    case BPF_RET | BPF_A:
+      return a;
+    case BPF_LD | BPF_W | BPF_ABS:
+    case BPF_LD | BPF_H | BPF_ABS:
+    case BPF_LD | BPF_B | BPF_ABS:
+      if (!load(data, caplen, k, loadSize(insn.code), &a))
+        return 0;
+      break;
+    case BPF_LD | BPF_W | BPF_IND:
+    case BPF_LD | BPF_H | BPF_IND:
+    case BPF_LD | BPF_B | BPF_IND:
+      if (!load(data, caplen, static_cast<uint64_t>(x) + k,
+                loadSize(insn.code), &a))
+        return 0;
+      break;
+    case BPF_LD | BPF_W | BPF_LEN:
+      a = wirelen;
+      break;
+    case BPF_LDX | BPF_W | BPF_LEN:
+      x = wirelen;
+      break;
+    case BPF_LDX | BPF_MSH | BPF_B:
+      if (k >= caplen)
+        return 0;
+      x = (data[k] & 0xf) << 2;
+      break;
+    case BPF_LD | BPF_IMM:
+      a = k;
+      break;
+    case BPF_LDX | BPF_IMM:
+      x = k;
+      break;
+    case BPF_LD | BPF_MEM:
+      if (k >= BPF_MEMWORDS)
+        return 0;
+      a = mem[k];
+      break;
+    case BPF_LDX | BPF_MEM:
+      if (k >= BPF_MEMWORDS)
+        return 0;
+      x = mem[k];
+      break;
+    case BPF_ST:
+      if (k >= BPF_MEMWORDS)
+        return 0;
+      mem[k] = a;
+      break;
+    case BPF_STX:
+      if (k >= BPF_MEMWORDS)
+        return 0;
+      mem[k] = x;
+      break;
+    case BPF_JMP | BPF_JA:
+      pc += k;
+      break;
+    case BPF_JMP | BPF_JGT | BPF_K:
+      pc += (a > k) ? insn.jt : insn.jf;
+      break;
+    case BPF_JMP | BPF_JGE | BPF_K:
+      pc += (a >= k) ? insn.jt : insn.jf;
+      break;
+    case BPF_JMP | BPF_JEQ | BPF_K:
+      pc += (a == k) ? insn.jt : insn.jf;
+      break;
+    case BPF_JMP | BPF_JSET | BPF_K:
+      pc += (a & k) ? insn.jt : insn.jf;
+      break;
+    case BPF_JMP | BPF_JGT | BPF_X:
+      pc += (a > x) ? insn.jt : insn.jf;
+      break;
+    case BPF_JMP | BPF_JGE | BPF_X:
+      pc += (a >= x) ? insn.jt : insn.jf;
+      break;
+    case BPF_JMP | BPF_JEQ | BPF_X:
+      pc += (a == x) ? insn.jt : insn.jf;
+      break;
+    case BPF_JMP | BPF_JSET | BPF_X:
+      pc += (a & x) ? insn.jt : insn.jf;
+      break;
+    case BPF_ALU | BPF_NEG:
+      a = -a;
+      break;
+    case BPF_MISC | BPF_TAX:
+      x = a;
+      break;
+    case BPF_MISC | BPF_TXA:
+      a = x;
+      break;
+    default:
+      if (BPF_CLASS(insn.code) == BPF_ALU) {
+        if (!alu(BPF_OP(insn.code), &a, BPF_SRC(insn.code) == BPF_X ? x : k))
+          return 0;
+        break;
+      }
+      return 0;
+    }
+  }
+  return 0;
+}
+
+bool Prefilter::decode() {
+  // Translates the program once into ops with absolute jump targets, checking
+  // bounds and opcodes up front so that run() does not have to. A load
+  // followed by a constant comparison that nothing else jumps to is fused
+  // into a single op, which covers most of what pcap_compile() emits.
+  const size_t size = program.size();
+  std::vector<bool> target(size, false);
+  for (size_t i = 0; i < size; ++i) {
+    const Pcap::Instruction &insn = program[i];
+    if (BPF_CLASS(insn.code) != BPF_JMP)
+      continue;
+    if (BPF_OP(insn.code) == BPF_JA) {
+      if (insn.k >= size - i - 1)
+        return false;
+      target[i + 1 + insn.k] = true;
+    } else {
+      if (insn.jt >= size - i - 1 || insn.jf >= size - i - 1)
+        return false;
+      target[i + 1 + insn.jt] = true;
+      target[i + 1 + insn.jf] = true;
+    }
+  }
+
+  // Instruction index to op index.
+  std::vector<uint32_t> index(size, 0);
+  std::vector<Op> list;
+  for (size_t i = 0; i < size; ++i) {
+    const Pcap::Instruction &insn = program[i];
+    Op op = {0, 0, 0, insn.k, 0, 0, 0};
+    index[i] = list.size();
+
+    switch (insn.code) {
+    case BPF_RET | BPF_K:
+      op.kind = OP_RET_K;
+      break;
+    case BPF_RET | BPF_A:
+      op.kind = OP_RET_A;
+      break;
+    case BPF_LD | BPF_W | BPF_ABS:
+    case BPF_LD | BPF_H | BPF_ABS:
+    case BPF_LD | BPF_B | BPF_ABS:
+      op.kind = OP_LD_ABS;
+      op.size = loadSize(insn.code);
+      if (i + 1 < size && !target[i + 1] &&
+          BPF_CLASS(program[i + 1].code) == BPF_JMP &&
+          BPF_SRC(program[i + 1].code) == BPF_K) {
+        const Pcap::Instruction &jmp = program[i + 1];
+        int fused = -1;
+        switch (BPF_OP(jmp.code)) {
+        case BPF_JEQ:
+          fused = OP_LD_ABS_JEQ;
+          break;
+        case BPF_JGT:
+          fused = OP_LD_ABS_JGT;
+          break;
+        case BPF_JGE:
+          fused = OP_LD_ABS_JGE;
+          break;
+        case BPF_JSET:
+          fused = OP_LD_ABS_JSET;
+          break;
+        }
+        if (fused >= 0) {
+          op.kind = fused;
+          op.cmp = jmp.k;
+          op.jt = i + 2 + jmp.jt;
+          op.jf = i + 2 + jmp.jf;
+          ++i;
+          index[i] = list.size();
+        }
+      }
+      break;
+    case BPF_LD | BPF_W | BPF_IND:
+    case BPF_LD | BPF_H | BPF_IND:
+    case BPF_LD | BPF_B | BPF_IND:
+      op.kind = OP_LD_IND;
+      op.size = loadSize(insn.code);
+      break;
+    case BPF_LD | BPF_W | BPF_LEN:
+      op.kind = OP_LD_LEN;
+      break;
+    case BPF_LDX | BPF_W | BPF_LEN:
+      op.kind = OP_LDX_LEN;
+      break;
+    case BPF_LDX | BPF_MSH | BPF_B:
+      op.kind = OP_LDX_MSH;
+      break;
+    case BPF_LD | BPF_IMM:
+      op.kind = OP_LD_IMM;
+      break;
+    case BPF_LDX | BPF_IMM:
+      op.kind = OP_LDX_IMM;
+      break;
+    case BPF_LD | BPF_MEM:
+    case BPF_LDX | BPF_MEM:
+    case BPF_ST:
+    case BPF_STX:
+      if (insn.k >= BPF_MEMWORDS)
+        return false;
+      op.kind = insn.code == (BPF_LD | BPF_MEM)
+                    ? OP_LD_MEM
+                    : insn.code == (BPF_LDX | BPF_MEM)
+                          ? OP_LDX_MEM
+                          : insn.code == BPF_ST ? OP_ST : OP_STX;
+      break;
+    case BPF_JMP | BPF_JA:
+      op.kind = OP_JA;
+      op.jt = i + 1 + insn.k;
+      break;
+    case BPF_ALU | BPF_NEG:
+      op.kind = OP_NEG;
+      break;
+    case BPF_MISC | BPF_TAX:
+      op.kind = OP_TAX;
+      break;
+    case BPF_MISC | BPF_TXA:
+      op.kind = OP_TXA;
+      break;
+    default:
+      if (BPF_CLASS(insn.code) == BPF_JMP) {
+        const bool useX = BPF_SRC(insn.code) == BPF_X;
+        switch (BPF_OP(insn.code)) {
+        case BPF_JEQ:
+          op.kind = useX ? OP_JEQ_X : OP_JEQ_K;
+          break;
+        case BPF_JGT:
+          op.kind = useX ? OP_JGT_X : OP_JGT_K;
+          break;
+        case BPF_JGE:
+          op.kind = useX ? OP_JGE_X : OP_JGE_K;
+          break;
+        case BPF_JSET:
+          op.kind = useX ? OP_JSET_X : OP_JSET_K;
+          break;
+        default:
+          return false;
+        }
+        op.jt = i + 1 + insn.jt;
+        op.jf = i + 1 + insn.jf;
+      } else if (BPF_CLASS(insn.code) == BPF_ALU) {
+        op.kind = BPF_SRC(insn.code) == BPF_X ? OP_ALU_X : OP_ALU_K;
+        op.alu = BPF_OP(insn.code);
+        uint32_t probe = 0;
+        if (!alu(op.alu, &probe, 1))
+          return false;
+      } else {
+        return false;
+      }
+    }
+    list.push_back(op);
+  }
+
+  // Every path must end in a return; falling off the end is rejected.
+  if (list.empty() ||
+      (list.back().kind != OP_RET_K && list.back().kind != OP_RET_A))
+    return false;
+
+  for (Op &op : list) {
+    if (op.kind == OP_JA) {
+      op.jt = index[op.jt];
+    } else if ((op.kind >= OP_JEQ_K && op.kind <= OP_JSET_X) ||
+               op.kind >= OP_LD_ABS_JEQ) {
+      op.jt = index[op.jt];
+      op.jf = index[op.jf];
+    }
+  }
+  ops.swap(list);
+  return true;
+}
+
+uint32_t Prefilter::run(const uint8_t *data, uint32_t caplen,
+                        uint32_t wirelen) const {
+  uint32_t a = 0;
+  uint32_t x = 0;
+  uint32_t mem[BPF_MEMWORDS] = {0};
+
+  const Op *base = ops.data();
+  const Op *op = base;
+  while (true) {
+    switch (op->kind) {
+    case OP_RET_K:
+      return op->k;
+    case OP_RET_A:
+      return a;
+    case OP_LD_ABS:
+      if (!load(data, caplen, op->k, op->size, &a))
+        return 0;
+      break;
+    case OP_LD_IND:
+      if (!load(data, caplen, static_cast<uint64_t>(x) + op->k, op->size, &a))
+        return 0;
+      break;
+    case OP_LD_LEN:
+      a = wirelen;
+      break;
+    case OP_LDX_LEN:
+      x = wirelen;
+      break;
+    case OP_LDX_MSH:
+      if (op->k >= caplen)
+        return 0;
+      x = (data[op->k] & 0xf) << 2;
+      break;
+    case OP_LD_IMM:
+      a = op->k;
+      break;
+    case OP_LDX_IMM:
+      x = op->k;
+      break;
+    case OP_LD_MEM:
+      a = mem[op->k];
+      break;
+    case OP_LDX_MEM:
+      x = mem[op->k];
+      break;
+    case OP_ST:
+      mem[op->k] = a;
+      break;
+    case OP_STX:
+      mem[op->k] = x;
+      break;
+    case OP_JA:
+      op = base + op->jt;
+      continue;
+    case OP_JEQ_K:
+      op = base + ((a == op->k) ? op->jt : op->jf);
+      continue;
+    case OP_JGT_K:
+      op = base + ((a > op->k) ? op->jt : op->jf);
+      continue;
+    case OP_JGE_K:
+      op = base + ((a >= op->k) ? op->jt : op->jf);
+      continue;
+    case OP_JSET_K:
+      op = base + ((a & op->k) ? op->jt : op->jf);
+      continue;
+    case OP_JEQ_X:
+      op = base + ((a == x) ? op->jt : op->jf);
+      continue;
+    case OP_JGT_X:
+      op = base + ((a > x) ? op->jt : op->jf);
+      continue;
+    case OP_JGE_X:
+      op = base + ((a >= x) ? op->jt : op->jf);
+      continue;
+    case OP_JSET_X:
+      op = base + ((a & x) ? op->jt : op->jf);
+      continue;
+    case OP_ALU_K:
+      if (!alu(op->alu, &a, op->k))
+        return 0;
+      break;
+    case OP_ALU_X:
+      if (!alu(op->alu, &a, x))
+        return 0;
+      break;
+    case OP_NEG:
+      a = -a;
+      break;
+    case OP_TAX:
+      x = a;
+      break;
+    case OP_TXA:
+      a = x;
+      break;
+    case OP_LD_ABS_JEQ:
+      if (!load(data, caplen, op->k, op->size, &a))
+        return 0;
+      op = base + ((a == op->cmp) ? op->jt : op->jf);
+      continue;
+    case OP_LD_ABS_JGT:
+      if (!load(data, caplen, op->k, op->size, &a))
+        return 0;
+      op = base + ((a > op->cmp) ? op->jt : op->jf);
+      continue;
+    case OP_LD_ABS_JGE:
+      if (!load(data, caplen, op->k, op->size, &a))
+        return 0;
+      op = base + ((a >= op->cmp) ? op->jt : op->jf);
+      continue;
+    case OP_LD_ABS_JSET:
+      if (!load(data, caplen, op->k, op->size, &a))
+        return 0;
+      op = base + ((a & op->cmp) ? op->jt : op->jf);
+      continue;
+    default:
+      return 0;
+    }
+    ++op;
+  }
+}
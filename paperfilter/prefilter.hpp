@@ -0,0 +1,39 @@
+#ifndef PREFILTER_HPP
+#define PREFILTER_HPP
+
+#include "pcap.hpp"
+#include <cstdint>
+#include <vector>
+
+class Prefilter {
+public:
+  Prefilter(const std::vector<Pcap::Instruction> &program, bool jit);
+  ~Prefilter();
+  Prefilter(const Prefilter &) = delete;
+  Prefilter &operator=(const Prefilter &) = delete;
+  bool jit() const;
+  bool match(const uint8_t *data, uint32_t caplen, uint32_t wirelen) const;
+
+private:
+  struct Op {
+    uint8_t kind;
+    uint8_t size;
+    uint8_t alu;
+    uint32_t k;
+    uint32_t cmp;
+    uint32_t jt;
+    uint32_t jf;
+  };
+
+  bool decode();
+  uint32_t interpret(const uint8_t *data, uint32_t caplen,
+                     uint32_t wirelen) const;
+  uint32_t run(const uint8_t *data, uint32_t caplen, uint32_t wirelen) const;
+
+private:
+  std::vector<Pcap::Instruction> program;
+  std::vector<Op> ops;
+  bool compiled = false;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "script_cache.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+#include <v8pp/convert.hpp>
+#include <vector>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+namespace {
+typedef std::vector<uint8_t> Data;
+
+struct Entry {
+  std::mutex mutex;
+  std::shared_ptr<const Data> data;
+  bool loaded = false;
+};
+
+// FNV-1a, so that file names stay stable between builds. The V8 version is
+// hashed too; V8 would reject a cache produced by another version anyway.
+uint64_t hash(const std::string &source) {
+  uint64_t value = 14695981039346656037ull;
+  for (const std::string &str : {std::string(v8::V8::GetVersion()), source}) {
+    for (char c : str) {
+      value ^= static_cast<uint8_t>(c);
+      value *= 1099511628211ull;
+    }
+    value ^= str.size();
+  }
+  return value;
+}
+}
+
+class ScriptCache::Private {
+public:
+  std::shared_ptr<Entry> entry(uint64_t key);
+  std::string path(uint64_t key) const;
+  std::shared_ptr<const Data> read(uint64_t key) const;
+  void write(uint64_t key, const Data &data) const;
+
+public:
+  mutable std::mutex mutex;
+  std::unordered_map<uint64_t, std::shared_ptr<Entry>> entries;
+  std::string dir;
+};
+
+std::shared_ptr<Entry> ScriptCache::Private::entry(uint64_t key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<Entry> &entry = entries[key];
+  if (!entry)
+    entry = std::make_shared<Entry>();
+  return entry;
+}
+
+std::string ScriptCache::Private::path(uint64_t key) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (dir.empty())
+    return std::string();
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.v8cache",
+           static_cast<unsigned long long>(key));
+  return dir + name;
+}
+
+std::shared_ptr<const Data> ScriptCache::Private::read(uint64_t key) const {
+  const std::string &file = path(key);
+  if (file.empty())
+    return nullptr;
+  std::ifstream ifs(file, std::ios::binary);
+  if (!ifs)
+    return nullptr;
+  auto data = std::make_shared<Data>((std::istreambuf_iterator<char>(ifs)),
+                                     std::istreambuf_iterator<char>());
+  if (data->empty())
+    return nullptr;
+  return data;
+}
+
+void ScriptCache::Private::write(uint64_t key, const Data &data) const {
+  const std::string &file = path(key);
+  if (file.empty())
+    return;
+  // Written aside and renamed so that other processes never read a partial
+  // file.
+  const std::string &tmp = file + ".tmp";
+  {
+    std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+    if (!ofs)
+      return;
+    ofs.write(reinterpret_cast<const char *>(data.data()), data.size());
+    if (!ofs) {
+      ofs.close();
+      remove(tmp.c_str());
+      return;
+    }
+  }
+#ifdef _WIN32
+  remove(file.c_str());
+#endif
+  if (rename(tmp.c_str(), file.c_str()) != 0)
+    remove(tmp.c_str());
+}
+
+ScriptCache::ScriptCache() : d(new Private()) {}
+
+ScriptCache::~ScriptCache() {}
+
+ScriptCache &ScriptCache::instance() {
+  // Leaked so that dissector threads can still compile during exit.
+  static ScriptCache *cache = new ScriptCache();
+  return *cache;
+}
+
+void ScriptCache::setDirectory(const std::string &dir) {
+  if (!dir.empty()) {
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0755);
+#endif
+  }
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->dir = dir;
+}
+
+v8::MaybeLocal<v8::Script>
+ScriptCache::compile(v8::Isolate *isolate, const std::string &source,
+                     const std::string &resourceName) {
+  const uint64_t key = hash(source);
+  const std::shared_ptr<Entry> &entry = d->entry(key);
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+  v8::Local<v8::String> code = v8pp::to_v8(isolate, source);
+  v8::ScriptOrigin origin(v8pp::to_v8(isolate, resourceName));
+
+  // Other isolates wait here while the first one produces the cache.
+  std::unique_lock<std::mutex> lock(entry->mutex);
+  if (!entry->loaded) {
+    entry->data = d->read(key);
+    entry->loaded = true;
+  }
+
+  if (std::shared_ptr<const Data> data = entry->data) {
+    lock.unlock();
+    v8::ScriptCompiler::Source src(
+        code, origin,
+        new v8::ScriptCompiler::CachedData(data->data(), data->size()));
+    v8::MaybeLocal<v8::Script> script = v8::ScriptCompiler::Compile(
+        context, &src, v8::ScriptCompiler::kConsumeCodeCache);
+    if (!src.GetCachedData()->rejected)
+      return script;
+
+    // Produced by another V8 build or with other flags; replace it.
+    lock.lock();
+    if (entry->data != data)
+      return script;
+    entry->data.reset();
+  }
+
+  v8::ScriptCompiler::Source src(code, origin);
+  v8::MaybeLocal<v8::Script> script = v8::ScriptCompiler::Compile(
+      context, &src, v8::ScriptCompiler::kProduceCodeCache);
+  const v8::ScriptCompiler::CachedData *cached = src.GetCachedData();
+  if (!script.IsEmpty() && cached && cached->length > 0) {
+    auto data = std::make_shared<Data>(cached->data,
+                                       cached->data + cached->length);
+    entry->data = data;
+    d->write(key, *data);
+  }
+  return script;
+}
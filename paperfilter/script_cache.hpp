@@ -0,0 +1,32 @@
+#ifndef SCRIPT_CACHE_HPP
+#define SCRIPT_CACHE_HPP
+
+#include <memory>
+#include <string>
+#include <v8.h>
+
+// Process-wide V8 code cache keyed by a hash of the script source. The first
+// isolate to compile a script produces the cache; every other isolate, and
+// every later session reset, consumes it instead of parsing the source again.
+// With a directory set, entries are also kept on disk across runs.
+class ScriptCache {
+public:
+  static ScriptCache &instance();
+
+  void setDirectory(const std::string &dir);
+  v8::MaybeLocal<v8::Script> compile(v8::Isolate *isolate,
+                                     const std::string &source,
+                                     const std::string &resourceName);
+
+private:
+  ScriptCache();
+  ~ScriptCache();
+  ScriptCache(const ScriptCache &) = delete;
+  ScriptCache &operator=(const ScriptCache &) = delete;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
@@ -1,20 +1,34 @@
 #include "session.hpp"
 #include "buffer.hpp"
+#include "capture_writer.hpp"
 #include "dissector.hpp"
 #include "packet_dispatcher.hpp"
+#include "packet_exporter.hpp"
+#include "packet_replayer.hpp"
 #include "filter_thread.hpp"
 #include "layer.hpp"
 #include "packet.hpp"
 #include "packet_store.hpp"
+#include "payload_pin.hpp"
 #include "pcap.hpp"
+#include "pcap_file_reader.hpp"
+#include "pcap_parser.hpp"
 #include "permission.hpp"
+#include "prefilter.hpp"
+#include "script_cache.hpp"
 #include "stream_chunk.hpp"
 #include "stream_dispatcher.hpp"
 #include "log_message.hpp"
+#include "native_dissector.hpp"
 #include <nan.h>
+#include <node_buffer.h>
+#include <algorithm>
+#include <atomic>
 #include <thread>
 #include <chrono>
 #include <cmath>
+#include <iterator>
+#include <map>
 #include <unordered_set>
 #include <uv.h>
 #include <v8pp/class.hpp>
@@ -23,6 +37,54 @@
 
 using namespace v8;
 
+namespace {
+const size_t reanalyzeBatch = 1024;
+// Reads a per-packet column given as a Uint32Array or a plain array.
+bool column(v8::Local<v8::Object> table, const char *name,
+            std::vector<uint32_t> *values) {
+  Isolate *isolate = Isolate::GetCurrent();
+  Local<Value> value = table->Get(v8pp::to_v8(isolate, name));
+  if (value->IsUint32Array()) {
+    Local<Uint32Array> array = value.As<Uint32Array>();
+    values->resize(array->Length());
+    array->CopyContents(values->data(), values->size() * sizeof(uint32_t));
+  } else if (value->IsArray()) {
+    Local<Array> array = value.As<Array>();
+    values->resize(array->Length());
+    for (uint32_t i = 0; i < array->Length(); ++i) {
+      (*values)[i] = array->Get(i)->Uint32Value();
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Pins the Buffer's backing store, or copies it once if the store belongs to
+// someone else.
+std::shared_ptr<const char> pinBuffer(v8::Local<v8::Value> buffer,
+                                      size_t *size) {
+  std::shared_ptr<const char> data = PayloadPin::pin(buffer, size);
+  if (!data) {
+    const char *bytes = node::Buffer::Data(buffer);
+    auto copy = std::make_shared<std::vector<char>>(
+        bytes, bytes + node::Buffer::Length(buffer));
+    data = std::shared_ptr<const char>(copy, copy->data());
+    *size = copy->size();
+  }
+  return data;
+}
+
+bool hostLittleEndian() {
+  const uint16_t probe = 1;
+  return *reinterpret_cast<const uint8_t *>(&probe) == 1;
+}
+
+uint64_t delta(uint64_t current, uint64_t prev) {
+  return current >= prev ? current - prev : current;
+}
+}
+
 struct FilterContext {
   std::vector<std::unique_ptr<FilterThread>> threads;
   std::shared_ptr<FilterThread::Context> ctx;
@@ -31,12 +93,37 @@ struct FilterContext {
   uint32_t initialMaxSeq = 0;
 };
 
+struct ExportContext {
+  uint64_t id = 0;
+  std::unique_ptr<PacketExporter> exporter;
+};
+
+struct ExportProgress {
+  std::string path;
+  PacketExporter::Progress progress;
+};
+
 class Session::Private {
 public:
   Private();
   ~Private();
   void log(const LogMessage &msg);
-  v8::Local<v8::Object> status();
+  void analyze(std::vector<std::unique_ptr<Packet>> packets);
+  void reanalyze(std::vector<std::unique_ptr<Packet>> packets);
+  void stopReanalyze();
+  bool accept(const Prefilter &prefilter, const Packet &pkt);
+  std::vector<std::unique_ptr<Packet>>
+  prefilterPackets(const Prefilter &prefilter,
+                   std::vector<std::unique_ptr<Packet>> packets);
+  std::function<void(std::vector<std::unique_ptr<Packet>>)> fileSink();
+  bool compilePrefilter(const std::string &filter,
+                        std::shared_ptr<Prefilter> *prefilter,
+                        std::string *error);
+  std::unique_ptr<Pcap> createPcap(uint32_t index);
+  bool openCaptureWriter(std::string *error);
+  void closeCaptureWriter();
+  void updateReorderWindow();
+  v8::Local<v8::Object> status(bool advance);
 
 public:
   std::unique_ptr<PacketStore> store;
@@ -47,21 +134,63 @@ public:
 
   UniquePersistent<Function> statusCb;
   UniquePersistent<Function> logCb;
+  UniquePersistent<Function> exportCb;
   uv_async_t statusCbAsync;
   uv_async_t logCbAsync;
+  uv_async_t exportCbAsync;
 
   std::unique_ptr<StreamDispatcher> streamDispatcher;
-  std::unique_ptr<Pcap> pcap;
+  std::vector<std::unique_ptr<Pcap>> pcaps;
+  std::string bpf;
+  int reorderWindow = 10;
+  OverloadOption overload;
+  bool flowAffinity = false;
+
+  // The BPF program also runs in userspace on packets given to analyze().
+  std::shared_ptr<Prefilter> prefilter;
+  int prefilterLinkType = 1; // DLT_EN10MB
+  bool prefilterJit = true;
+  std::atomic<uint64_t> prefiltered;
+
+  std::vector<std::unique_ptr<PcapFileReader>> readers;
+  std::unique_ptr<PacketReplayer> replayer;
+
+  // Packets of the previous store are analyzed again off the main thread;
+  // the dispatcher may block once they exceed its queue limit.
+  std::thread reanalyzeThread;
+  std::atomic<bool> reanalyzeCancelled;
+
+  // Section and interface state carried between analyzeRaw() calls.
+  PcapParser rawParser;
+
+  // Raw frames from the capture threads are also written here. Accessed with
+  // std::atomic_load/std::atomic_store.
+  std::shared_ptr<CaptureWriter> captureWriter;
+  CaptureWriter::Context captureFile;
+  uint64_t prevCaptureDropped = 0;
+
+  // Keyed by destination path. Progress is keyed by export id instead, so
+  // that a cancelled export cannot be mistaken for a newer one to the same
+  // path.
+  std::unordered_map<std::string, ExportContext> exporters;
+  uint64_t exportId = 0;
+  std::mutex exportMutex;
+  std::map<uint64_t, ExportProgress> exportProgress;
 
   std::mutex errorMutex;
   std::unordered_map<std::string, LogMessage> recentLogs;
 
   uint32_t prevQueue = 0;
+  Pcap::Stats prevStats;
+  uint64_t prevShed = 0;
+  OverloadStats prevOverload;
+  OverloadStats prevStreamOverload;
+  uint64_t prevPrefiltered = 0;
   bool capturing = false;
   int threads;
 };
 
-Session::Private::Private() {
+Session::Private::Private() : prefiltered(0), reanalyzeCancelled(false) {
   logCbAsync.data = this;
   uv_async_init(uv_default_loop(), &logCbAsync, [](uv_async_t *handle) {
     Session::Private *d = static_cast<Session::Private *>(handle->data);
@@ -101,6 +230,42 @@ Session::Private::Private() {
     }
   });
 
+  exportCbAsync.data = this;
+  uv_async_init(uv_default_loop(), &exportCbAsync, [](uv_async_t *handle) {
+    Session::Private *d = static_cast<Session::Private *>(handle->data);
+    std::map<uint64_t, ExportProgress> progress;
+    {
+      std::lock_guard<std::mutex> lock(d->exportMutex);
+      progress.swap(d->exportProgress);
+    }
+
+    Isolate *isolate = Isolate::GetCurrent();
+    for (const auto &pair : progress) {
+      const std::string &path = pair.second.path;
+      const PacketExporter::Progress &prog = pair.second.progress;
+      if (prog.done) {
+        auto it = d->exporters.find(path);
+        if (it != d->exporters.end() && it->second.id == pair.first)
+          d->exporters.erase(it);
+      }
+      if (d->exportCb.IsEmpty())
+        continue;
+
+      Local<Object> obj = Object::New(isolate);
+      v8pp::set_option(isolate, obj, "path", path);
+      v8pp::set_option(isolate, obj, "packets", prog.packets);
+      v8pp::set_option(isolate, obj, "total", prog.total);
+      v8pp::set_option(isolate, obj, "bytes", static_cast<double>(prog.bytes));
+      v8pp::set_option(isolate, obj, "done", prog.done);
+      if (!prog.error.empty())
+        v8pp::set_option(isolate, obj, "error", prog.error);
+
+      Handle<Value> args[1] = {obj};
+      Local<Function> func = Local<Function>::New(isolate, d->exportCb);
+      func->Call(isolate->GetCurrentContext()->Global(), 1, args);
+    }
+  });
+
   statusCbAsync.data = this;
   uv_async_init(uv_default_loop(), &statusCbAsync, [](uv_async_t *handle) {
     Session::Private *d = static_cast<Session::Private *>(handle->data);
@@ -120,14 +285,14 @@ Session::Private::Private() {
       d->prevQueue = queue;
 
       Isolate *isolate = Isolate::GetCurrent();
-      Handle<Value> args[1] = {d->status()};
+      Handle<Value> args[1] = {d->status(true)};
       Local<Function> func = Local<Function>::New(isolate, d->statusCb);
       func->Call(isolate->GetCurrentContext()->Global(), 1, args);
     }
   });
 }
 
-v8::Local<v8::Object> Session::Private::status() {
+v8::Local<v8::Object> Session::Private::status(bool advance) {
   uint32_t packets = store->maxSeq();
   uint32_t queue =
       packetDispatcher->queueSize() + streamDispatcher->queueSize();
@@ -160,6 +325,77 @@ v8::Local<v8::Object> Session::Private::status() {
   }
 
   v8pp::set_option(isolate, obj, "filtered", filtered);
+
+  // Drop accounting, reported as deltas since the previous status callback.
+  // Only the callback advances the baselines; reading Session.status does not.
+  Pcap::Stats stats;
+  for (const auto &pcap : pcaps) {
+    const Pcap::Stats &ps = pcap->stats();
+    stats.received += ps.received;
+    stats.dropped += ps.dropped;
+    stats.ifdropped += ps.ifdropped;
+    stats.freezes += ps.freezes;
+  }
+  uint64_t shed = packetDispatcher->shedPackets();
+  const OverloadStats &overloadStats = packetDispatcher->overloadStats();
+  const OverloadStats &streamOverloadStats =
+      streamDispatcher->overloadStats();
+
+  Local<Object> drops = Object::New(isolate);
+  v8pp::set_option(isolate, drops, "received",
+                   delta(stats.received, prevStats.received));
+  v8pp::set_option(isolate, drops, "dropped",
+                   delta(stats.dropped, prevStats.dropped));
+  v8pp::set_option(isolate, drops, "ifdropped",
+                   delta(stats.ifdropped, prevStats.ifdropped));
+  v8pp::set_option(isolate, drops, "ringFreezes",
+                   delta(stats.freezes, prevStats.freezes));
+  v8pp::set_option(isolate, drops, "queueHighWater",
+                   advance ? packetDispatcher->takeQueueHighWater()
+                           : packetDispatcher->queueHighWater());
+  v8pp::set_option(isolate, drops, "shed", delta(shed, prevShed));
+  Local<Object> overload = Object::New(isolate);
+  v8pp::set_option(isolate, overload, "blocked",
+                   delta(overloadStats.blocked, prevOverload.blocked));
+  v8pp::set_option(isolate, overload, "dropped",
+                   delta(overloadStats.dropped, prevOverload.dropped));
+  v8pp::set_option(isolate, overload, "raw",
+                   delta(overloadStats.raw, prevOverload.raw));
+  v8pp::set_option(isolate, overload, "sampled",
+                   delta(overloadStats.sampled, prevOverload.sampled));
+  v8pp::set_option(isolate, overload, "streamDropped",
+                   delta(streamOverloadStats.dropped,
+                         prevStreamOverload.dropped));
+  v8pp::set_option(isolate, overload, "streamSampled",
+                   delta(streamOverloadStats.sampled,
+                         prevStreamOverload.sampled));
+  v8pp::set_option(isolate, drops, "overload", overload);
+  v8pp::set_option(isolate, drops, "prefiltered",
+                   delta(prefiltered, prevPrefiltered));
+  if (const auto &writer = std::atomic_load(&captureWriter)) {
+    const CaptureWriter::Stats &fileStats = writer->stats();
+    v8pp::set_option(isolate, drops, "captureFile",
+                     delta(fileStats.dropped, prevCaptureDropped));
+    if (advance)
+      prevCaptureDropped = fileStats.dropped;
+
+    Local<Object> file = Object::New(isolate);
+    v8pp::set_option(isolate, file, "path", writer->currentFile());
+    v8pp::set_option(isolate, file, "files", fileStats.files);
+    v8pp::set_option(isolate, file, "packets",
+                     static_cast<double>(fileStats.packets));
+    v8pp::set_option(isolate, file, "bytes",
+                     static_cast<double>(fileStats.bytes));
+    v8pp::set_option(isolate, obj, "captureFile", file);
+  }
+  v8pp::set_option(isolate, obj, "drops", drops);
+  if (advance) {
+    prevStats = stats;
+    prevShed = shed;
+    prevOverload = overloadStats;
+    prevStreamOverload = streamOverloadStats;
+    prevPrefiltered = prefiltered;
+  }
   return obj;
 }
 
@@ -171,13 +407,159 @@ void Session::Private::log(const LogMessage &msg) {
   uv_async_send(&logCbAsync);
 }
 
+void Session::Private::analyze(std::vector<std::unique_ptr<Packet>> packets) {
+  for (auto &pkt : packets) {
+    const auto &layer = std::make_shared<Layer>(ns);
+    layer->setName("Frame");
+    layer->setPayload(pkt->payload());
+    pkt->addLayer(layer);
+  }
+  packetDispatcher->analyze(std::move(packets));
+}
+
+void Session::Private::reanalyze(
+    std::vector<std::unique_ptr<Packet>> packets) {
+  for (size_t i = 0; i < packets.size() && !reanalyzeCancelled;
+       i += reanalyzeBatch) {
+    const size_t end = std::min(i + reanalyzeBatch, packets.size());
+    analyze(std::vector<std::unique_ptr<Packet>>(
+        std::make_move_iterator(packets.begin() + i),
+        std::make_move_iterator(packets.begin() + end)));
+  }
+}
+
+void Session::Private::stopReanalyze() {
+  reanalyzeCancelled = true;
+  if (reanalyzeThread.joinable())
+    reanalyzeThread.join();
+  reanalyzeCancelled = false;
+}
+
+bool Session::Private::accept(const Prefilter &prefilter, const Packet &pkt) {
+  std::unique_ptr<Buffer> payload = pkt.payload();
+  if (!payload)
+    return true;
+  if (prefilter.match(reinterpret_cast<const uint8_t *>(payload->data()),
+                      payload->length(), pkt.length()))
+    return true;
+  ++prefiltered;
+  return false;
+}
+
+std::vector<std::unique_ptr<Packet>> Session::Private::prefilterPackets(
+    const Prefilter &prefilter, std::vector<std::unique_ptr<Packet>> packets) {
+  std::vector<std::unique_ptr<Packet>> accepted;
+  for (auto &pkt : packets) {
+    if (accept(prefilter, *pkt))
+      accepted.push_back(std::move(pkt));
+  }
+  return accepted;
+}
+
+std::function<void(std::vector<std::unique_ptr<Packet>>)>
+Session::Private::fileSink() {
+  // File sources keep the filter they were started with; setBPF() only
+  // affects later ones.
+  std::shared_ptr<Prefilter> filter = prefilter;
+  return [this, filter](std::vector<std::unique_ptr<Packet>> packets) {
+    if (filter)
+      packets = prefilterPackets(*filter, std::move(packets));
+    if (!packets.empty())
+      analyze(std::move(packets));
+  };
+}
+
+bool Session::Private::compilePrefilter(const std::string &filter,
+                                        std::shared_ptr<Prefilter> *prefilter,
+                                        std::string *error) {
+  prefilter->reset();
+  if (filter.empty())
+    return true;
+  std::vector<Pcap::Instruction> program;
+  if (!Pcap::compile(filter, prefilterLinkType, 65535, &program, error))
+    return false;
+  prefilter->reset(new Prefilter(program, prefilterJit));
+  return true;
+}
+
+std::unique_ptr<Pcap> Session::Private::createPcap(uint32_t index) {
+  auto pcapCtx = std::make_shared<Pcap::Context>();
+  pcapCtx->logCb = std::bind(&Private::log, this, std::placeholders::_1);
+  pcapCtx->packetCb = [this, index](std::unique_ptr<Packet> pkt) {
+    std::vector<std::unique_ptr<Packet>> packets;
+    pkt->setInterfaceIndex(index);
+    if (const auto &writer = std::atomic_load(&captureWriter))
+      writer->push(*pkt);
+    packets.push_back(std::move(pkt));
+    analyze(std::move(packets));
+  };
+  pcapCtx->packetsCb = [this, index](
+      std::vector<std::unique_ptr<Packet>> packets) {
+    const auto &writer = std::atomic_load(&captureWriter);
+    for (auto &pkt : packets) {
+      pkt->setInterfaceIndex(index);
+      if (writer)
+        writer->push(*pkt);
+    }
+    analyze(std::move(packets));
+  };
+
+  std::unique_ptr<Pcap> pcap(new Pcap(pcapCtx));
+  if (!pcaps.empty()) {
+    const Pcap &base = *pcaps.front();
+    pcap->setPromiscuous(base.promiscuous());
+    pcap->setSnaplen(base.snaplen());
+    pcap->setBackend(base.backend());
+    pcap->setRingOption(base.ringOption());
+    pcap->setPcapOption(base.pcapOption());
+    pcap->setBatchOption(base.batchOption());
+  }
+  return pcap;
+}
+
+bool Session::Private::openCaptureWriter(std::string *error) {
+  closeCaptureWriter();
+  if (captureFile.path.empty())
+    return true;
+
+  auto ctx = std::make_shared<CaptureWriter::Context>(captureFile);
+  ctx->linkType = prefilterLinkType;
+  ctx->snaplen = pcaps.front()->snaplen();
+  ctx->logCb = std::bind(&Private::log, this, std::placeholders::_1);
+  std::shared_ptr<CaptureWriter> writer = std::make_shared<CaptureWriter>(ctx);
+  if (!writer->open(error))
+    return false;
+  prevCaptureDropped = 0;
+  std::atomic_store(&captureWriter, writer);
+  return true;
+}
+
+void Session::Private::closeCaptureWriter() {
+  // Capture threads may still hold a reference; close() flushes and waits
+  // for the writer thread, and their last pushes are counted as dropped.
+  if (const auto &writer = std::atomic_load(&captureWriter)) {
+    std::atomic_store(&captureWriter, std::shared_ptr<CaptureWriter>());
+    writer->close();
+  }
+}
+
+void Session::Private::updateReorderWindow() {
+  packetDispatcher->setReorderWindow(pcaps.size() > 1 ? reorderWindow : 0);
+}
+
 Session::Private::~Private() {
+  stopReanalyze();
+  exporters.clear();
+  closeCaptureWriter();
   filterThreads.clear();
+  replayer.reset();
+  readers.clear();
+  pcaps.clear();
   streamDispatcher.reset();
   packetDispatcher.reset();
-  pcap.reset();
   uv_close((uv_handle_t *)&statusCbAsync, nullptr);
   uv_close((uv_handle_t *)&logCbAsync, nullptr);
+  uv_close((uv_handle_t *)&exportCbAsync, nullptr);
 }
 
 Session::Session(v8::Local<v8::Object> option) : d(new Private()) {
@@ -190,6 +572,8 @@ Session::~Session() {
 }
 
 void Session::analyze(std::unique_ptr<Packet> pkt) {
+  if (d->prefilter && !d->accept(*d->prefilter, *pkt))
+    return;
   const auto &layer = std::make_shared<Layer>(d->ns);
   layer->setName("Frame");
   layer->setPayload(pkt->payload());
@@ -198,13 +582,260 @@ void Session::analyze(std::unique_ptr<Packet> pkt) {
 }
 
 void Session::analyze(std::vector<std::unique_ptr<Packet>> packets) {
-  for (auto &pkt : packets) {
-    const auto &layer = std::make_shared<Layer>(d->ns);
-    layer->setName("Frame");
-    layer->setPayload(pkt->payload());
-    pkt->addLayer(layer);
+  if (d->prefilter)
+    packets = d->prefilterPackets(*d->prefilter, std::move(packets));
+  if (!packets.empty())
+    d->analyze(std::move(packets));
+}
+
+bool Session::analyzeBuffer(v8::Local<v8::Value> buffer,
+                            v8::Local<v8::Object> table, std::string *error) {
+  Isolate *isolate = Isolate::GetCurrent();
+  if (!node::Buffer::HasInstance(buffer)) {
+    error->assign("buffer must be a Buffer");
+    return false;
+  }
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> lengths;
+  if (!column(table, "offsets", &offsets) ||
+      !column(table, "lengths", &lengths) ||
+      offsets.size() != lengths.size()) {
+    error->assign("offsets and lengths must be arrays of the same length");
+    return false;
+  }
+  std::vector<uint32_t> origLengths;
+  std::vector<uint32_t> tsSec;
+  std::vector<uint32_t> tsNsec;
+  column(table, "length", &origLengths);
+  column(table, "ts_sec", &tsSec);
+  column(table, "ts_nsec", &tsNsec);
+  uint32_t interfaceIndex = 0;
+  v8pp::get_option(isolate, table, "interfaceIndex", interfaceIndex);
+
+  size_t size = 0;
+  std::shared_ptr<const char> data = pinBuffer(buffer, &size);
+
+  std::vector<std::unique_ptr<Packet>> packets;
+  packets.reserve(offsets.size());
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    if (offsets[i] > size || lengths[i] > size - offsets[i]) {
+      error->assign("packet " + std::to_string(i) + " is out of range");
+      return false;
+    }
+    std::unique_ptr<Buffer> payload(new Buffer(
+        std::shared_ptr<const char>(data, data.get() + offsets[i]),
+        lengths[i]));
+    uint32_t length = i < origLengths.size() ? origLengths[i] : lengths[i];
+    std::unique_ptr<Packet> pkt(new Packet(std::move(payload), length));
+    if (i < tsSec.size())
+      pkt->setTimestamp(tsSec[i], i < tsNsec.size() ? tsNsec[i] : 0);
+    pkt->setInterfaceIndex(interfaceIndex);
+    packets.push_back(std::move(pkt));
   }
-  d->packetDispatcher->analyze(std::move(packets));
+  analyze(std::move(packets));
+  return true;
+}
+
+bool Session::analyzeRaw(v8::Local<v8::Value> buffer,
+                         v8::Local<v8::Object> opt, size_t *consumed,
+                         std::string *error) {
+  Isolate *isolate = Isolate::GetCurrent();
+  if (!node::Buffer::HasInstance(buffer)) {
+    error->assign("buffer must be a Buffer");
+    return false;
+  }
+  size_t size = 0;
+  std::shared_ptr<const char> data = pinBuffer(buffer, &size);
+  const uint8_t *begin = reinterpret_cast<const uint8_t *>(data.get());
+
+  // A file header sets the format; a pcapng section header starts a section
+  // whose interface ids follow those of the previous one. Otherwise the
+  // records continue the previous call unless the options describe a new
+  // stream.
+  size_t offset = 0;
+  std::string format;
+  if (PcapParser::isHeader(begin, size)) {
+    if (!d->rawParser.readHeader(begin, size, &offset, error))
+      return false;
+  } else if (v8pp::get_option(isolate, opt, "format", format)) {
+    if (format != "pcap" && format != "pcapng") {
+      error->assign("unknown format: " + format);
+      return false;
+    }
+    bool littleEndian = true;
+    bool nanosec = false;
+    v8pp::get_option(isolate, opt, "littleEndian", littleEndian);
+    v8pp::get_option(isolate, opt, "nanosec", nanosec);
+    d->rawParser.setFormat(format == "pcapng",
+                           littleEndian != hostLittleEndian(), nanosec);
+  }
+
+  // Every packet aliases the pinned buffer; the whole block goes to the
+  // dispatcher in one call.
+  std::vector<std::unique_ptr<Packet>> packets;
+  auto push = [&](const PcapParser::Record &record) {
+    const char *bytes = reinterpret_cast<const char *>(record.data);
+    std::unique_ptr<Buffer> payload(
+        new Buffer(std::shared_ptr<const char>(data, bytes), record.caplen));
+    std::unique_ptr<Packet> pkt(new Packet(std::move(payload), record.length));
+    pkt->setTimestamp(record.sec, record.nsec);
+    pkt->setInterfaceIndex(record.interfaceIndex);
+    packets.push_back(std::move(pkt));
+    return true;
+  };
+  *consumed =
+      offset + d->rawParser.parse(begin + offset, size - offset, push, error);
+  if (!packets.empty())
+    analyze(std::move(packets));
+  return error->empty();
+}
+
+bool Session::load(const std::string &path, std::string *error) {
+  for (auto it = d->readers.begin(); it != d->readers.end();) {
+    if ((*it)->finished()) {
+      it = d->readers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  auto ctx = std::make_shared<PcapFileReader::Context>();
+  ctx->logCb = std::bind(&Private::log, std::ref(d), std::placeholders::_1);
+  ctx->packetsCb = d->fileSink();
+  ctx->backlogCb = [this]() { return d->packetDispatcher->queueSize(); };
+
+  std::unique_ptr<PcapFileReader> reader(new PcapFileReader(ctx));
+  if (!reader->open(path, error))
+    return false;
+  reader->start();
+  d->readers.push_back(std::move(reader));
+  return true;
+}
+
+bool Session::replay(const std::string &path, v8::Local<v8::Object> opt,
+                     std::string *error) {
+  Isolate *isolate = Isolate::GetCurrent();
+  auto ctx = std::make_shared<PacketReplayer::Context>();
+  v8pp::get_option(isolate, opt, "speed", ctx->speed);
+  v8pp::get_option(isolate, opt, "pps", ctx->pps);
+  v8pp::get_option(isolate, opt, "bps", ctx->bps);
+  v8pp::get_option(isolate, opt, "loops", ctx->loops);
+  v8pp::get_option(isolate, opt, "randomizeFlows", ctx->randomizeFlows);
+  v8pp::get_option(isolate, opt, "sampleInterval", ctx->sampleInterval);
+  ctx->sampleInterval = std::max(ctx->sampleInterval, 1u);
+  ctx->packetsCb = d->fileSink();
+  ctx->logCb = std::bind(&Private::log, std::ref(d), std::placeholders::_1);
+  ctx->queueCb = [this]() {
+    return d->packetDispatcher->queueSize() + d->streamDispatcher->queueSize();
+  };
+
+  d->replayer.reset();
+  std::unique_ptr<PacketReplayer> replayer(new PacketReplayer(ctx));
+  if (!replayer->open(path, error))
+    return false;
+  replayer->start();
+  d->replayer = std::move(replayer);
+  return true;
+}
+
+void Session::stopReplay() {
+  if (d->replayer)
+    d->replayer->stop();
+}
+
+v8::Local<v8::Object> Session::replayStatus() const {
+  Isolate *isolate = Isolate::GetCurrent();
+  Local<Object> obj = Object::New(isolate);
+  PacketReplayer::Stats stats;
+  if (d->replayer)
+    stats = d->replayer->stats();
+  v8pp::set_option(isolate, obj, "running", stats.running);
+  v8pp::set_option(isolate, obj, "packets", static_cast<double>(stats.packets));
+  v8pp::set_option(isolate, obj, "bytes", static_cast<double>(stats.bytes));
+  v8pp::set_option(isolate, obj, "loops", stats.loops);
+  Local<Array> samples = Array::New(isolate, stats.samples.size());
+  for (size_t i = 0; i < stats.samples.size(); ++i) {
+    const PacketReplayer::Sample &sample = stats.samples[i];
+    Local<Object> s = Object::New(isolate);
+    v8pp::set_option(isolate, s, "time", sample.time);
+    v8pp::set_option(isolate, s, "queue", sample.queue);
+    v8pp::set_option(isolate, s, "packets",
+                     static_cast<double>(sample.packets));
+    samples->Set(i, s);
+  }
+  v8pp::set_option(isolate, obj, "samples", samples);
+  return obj;
+}
+
+bool Session::exportPackets(const std::string &path, v8::Local<v8::Object> opt,
+                            std::string *error) {
+  Isolate *isolate = Isolate::GetCurrent();
+  if (d->exporters.count(path)) {
+    error->assign("already exporting to " + path);
+    return false;
+  }
+
+  auto ctx = std::make_shared<PacketExporter::Context>();
+  ctx->store = d->store.get();
+  ctx->linkType = d->prefilterLinkType;
+  ctx->snaplen = snaplen();
+
+  std::string format;
+  if (!v8pp::get_option(isolate, opt, "format", format)) {
+    const std::string ext = ".pcapng";
+    if (path.size() >= ext.size() &&
+        path.compare(path.size() - ext.size(), ext.size(), ext) == 0)
+      format = "pcapng";
+  }
+  if (format == "pcapng") {
+    ctx->format = PacketExporter::FORMAT_PCAPNG;
+  } else if (format.empty() || format == "pcap") {
+    ctx->format = PacketExporter::FORMAT_PCAP;
+  } else {
+    error->assign("unknown format: " + format);
+    return false;
+  }
+
+  std::string filterName;
+  if (v8pp::get_option(isolate, opt, "filterName", filterName)) {
+    const auto it = d->filterThreads.find(filterName);
+    if (it == d->filterThreads.end()) {
+      error->assign("no such filter: " + filterName);
+      return false;
+    }
+    const std::shared_ptr<FilterThread::Context> &filterCtx = it->second.ctx;
+    ctx->filtered = std::shared_ptr<const FilteredPacketStore>(
+        filterCtx, &filterCtx->packets);
+  }
+
+  v8::Local<v8::Value> range;
+  if (v8pp::get_option(isolate, opt, "range", range) && range->IsArray() &&
+      range.As<v8::Array>()->Length() == 2) {
+    v8::Local<v8::Array> bounds = range.As<v8::Array>();
+    ctx->start = std::max(1u, bounds->Get(0)->Uint32Value());
+    ctx->end = bounds->Get(1)->Uint32Value();
+  }
+
+  const uint64_t id = ++d->exportId;
+  ctx->progressCb = [this, id, path](
+      const PacketExporter::Progress &progress) {
+    {
+      std::lock_guard<std::mutex> lock(d->exportMutex);
+      ExportProgress &entry = d->exportProgress[id];
+      entry.path = path;
+      entry.progress = progress;
+    }
+    uv_async_send(&d->exportCbAsync);
+  };
+
+  std::unique_ptr<PacketExporter> exporter(new PacketExporter(ctx));
+  if (!exporter->open(path, error))
+    return false;
+  exporter->start();
+  ExportContext &context = d->exporters[path];
+  context.id = id;
+  context.exporter = std::move(exporter);
+  return true;
 }
 
 void Session::filter(const std::string &name, const std::string &filter) {
@@ -236,6 +867,14 @@ void Session::setLogCallback(const v8::Local<v8::Function> &cb) {
   d->logCb.Reset(Isolate::GetCurrent(), cb);
 }
 
+Local<Function> Session::exportCallback() const {
+  return Local<Function>::New(Isolate::GetCurrent(), d->exportCb);
+}
+
+void Session::setExportCallback(const Local<Function> &cb) {
+  d->exportCb.Reset(Isolate::GetCurrent(), cb);
+}
+
 Local<Function> Session::statusCallback() const {
   return Local<Function>::New(Isolate::GetCurrent(), d->statusCb);
 }
@@ -278,29 +917,258 @@ v8::Local<v8::Array> Session::devices() {
 }
 
 void Session::setInterface(const std::string &ifs) {
-  d->pcap->setInterface(ifs);
+  setInterfaces(std::vector<std::string>(1, ifs));
 }
 std::string Session::networkInterface() const {
-  return d->pcap->networkInterface();
+  return d->pcaps.front()->networkInterface();
+}
+
+void Session::setInterfaces(const std::vector<std::string> &list) {
+  std::vector<std::string> ifs = list;
+  if (ifs.empty())
+    ifs.emplace_back();
+
+  const size_t existing = std::min(d->pcaps.size(), ifs.size());
+  d->pcaps.resize(existing);
+  while (d->pcaps.size() < ifs.size()) {
+    d->pcaps.push_back(d->createPcap(d->pcaps.size()));
+  }
+
+  for (size_t i = 0; i < ifs.size(); ++i) {
+    Pcap *pcap = d->pcaps[i].get();
+    if (pcap->networkInterface() == ifs[i])
+      continue;
+    pcap->setInterface(ifs[i]);
+    std::string err;
+    if (!ifs[i].empty() && !pcap->setBPF(d->bpf, &err)) {
+      LogMessage msg;
+      msg.level = LogMessage::LEVEL_ERROR;
+      msg.message = ifs[i] + ": " + err;
+      msg.domain = "pcap";
+      d->log(msg);
+    }
+    // start() first stops a capture still running on the old interface.
+    if (d->capturing)
+      pcap->start();
+  }
+  d->updateReorderWindow();
+}
+
+std::vector<std::string> Session::interfaces() const {
+  std::vector<std::string> list;
+  for (const auto &pcap : d->pcaps) {
+    list.push_back(pcap->networkInterface());
+  }
+  return list;
 }
-void Session::setPromiscuous(bool promisc) { d->pcap->setPromiscuous(promisc); }
-bool Session::promiscuous() const { return d->pcap->promiscuous(); }
-void Session::setSnaplen(int len) { d->pcap->setSnaplen(len); }
-int Session::snaplen() const { return d->pcap->snaplen(); }
+
+void Session::setPromiscuous(bool promisc) {
+  for (const auto &pcap : d->pcaps) {
+    pcap->setPromiscuous(promisc);
+  }
+}
+bool Session::promiscuous() const { return d->pcaps.front()->promiscuous(); }
+void Session::setSnaplen(int len) {
+  for (const auto &pcap : d->pcaps) {
+    pcap->setSnaplen(len);
+  }
+}
+int Session::snaplen() const { return d->pcaps.front()->snaplen(); }
 bool Session::setBPF(const std::string &filter, std::string *error) {
-  return d->pcap->setBPF(filter, error);
+  std::unique_ptr<Prefilter> prefilter;
+  if (!d->compilePrefilter(filter, &prefilter, error))
+    return false;
+
+  for (const auto &pcap : d->pcaps) {
+    if (pcap->networkInterface().empty())
+      continue;
+    if (!pcap->setBPF(filter, error)) {
+      for (const auto &prev : d->pcaps) {
+        prev->setBPF(d->bpf, nullptr);
+      }
+      return false;
+    }
+  }
+  d->bpf = filter;
+  d->prefilter = prefilter;
+  return true;
+}
+
+void Session::setCaptureOptions(v8::Local<v8::Object> opt) {
+  Isolate *isolate = Isolate::GetCurrent();
+
+  const Pcap &base = *d->pcaps.front();
+  Pcap::Backend backend = base.backend();
+  std::string backendName;
+  if (v8pp::get_option(isolate, opt, "backend", backendName)) {
+    backend = backendName == "ring" ? Pcap::BACKEND_RING : Pcap::BACKEND_PCAP;
+  }
+
+  Pcap::RingOption ring = base.ringOption();
+  v8pp::get_option(isolate, opt, "blockSize", ring.blockSize);
+  v8pp::get_option(isolate, opt, "blockCount", ring.blockCount);
+  v8pp::get_option(isolate, opt, "blockTimeout", ring.blockTimeout);
+  v8pp::get_option(isolate, opt, "fanout", ring.fanout);
+  std::string fanoutMode;
+  if (v8pp::get_option(isolate, opt, "fanoutMode", fanoutMode)) {
+    if (fanoutMode == "cpu") {
+      ring.fanoutMode = Pcap::FANOUT_CPU;
+    } else if (fanoutMode == "lb") {
+      ring.fanoutMode = Pcap::FANOUT_LB;
+    } else {
+      ring.fanoutMode = Pcap::FANOUT_HASH;
+    }
+  }
+
+  Pcap::PcapOption live = base.pcapOption();
+  v8pp::get_option(isolate, opt, "bufferSize", live.bufferSize);
+  v8pp::get_option(isolate, opt, "timeout", live.timeout);
+  v8pp::get_option(isolate, opt, "immediate", live.immediate);
+  v8pp::get_option(isolate, opt, "nanosecond", live.nanosecond);
+
+  Pcap::BatchOption batch = base.batchOption();
+  v8pp::get_option(isolate, opt, "batchSize", batch.size);
+  v8pp::get_option(isolate, opt, "batchTimeout", batch.timeout);
+
+  for (const auto &pcap : d->pcaps) {
+    pcap->setBackend(backend);
+    pcap->setRingOption(ring);
+    pcap->setPcapOption(live);
+    pcap->setBatchOption(batch);
+  }
+
+  if (v8pp::get_option(isolate, opt, "reorderWindow", d->reorderWindow))
+    d->updateReorderWindow();
+
+  std::string overloadPolicy;
+  if (v8pp::get_option(isolate, opt, "overloadPolicy", overloadPolicy)) {
+    if (overloadPolicy == "drop") {
+      d->overload.policy = OverloadOption::POLICY_DROP;
+    } else if (overloadPolicy == "raw") {
+      d->overload.policy = OverloadOption::POLICY_RAW;
+    } else if (overloadPolicy == "sample") {
+      d->overload.policy = OverloadOption::POLICY_SAMPLE;
+    } else {
+      d->overload.policy = OverloadOption::POLICY_BLOCK;
+    }
+  }
+  v8pp::get_option(isolate, opt, "queueLimit", d->overload.packetLimit);
+  v8pp::get_option(isolate, opt, "streamQueueLimit", d->overload.streamLimit);
+  v8pp::get_option(isolate, opt, "sampleRate", d->overload.sampleRate);
+  d->packetDispatcher->setOverloadOption(d->overload);
+  d->streamDispatcher->setOverloadOption(d->overload);
+
+  if (v8pp::get_option(isolate, opt, "flowAffinity", d->flowAffinity))
+    d->packetDispatcher->setFlowAffinity(d->flowAffinity);
+
+  bool prefilterChanged =
+      v8pp::get_option(isolate, opt, "prefilterLinkType",
+                       d->prefilterLinkType) |
+      v8pp::get_option(isolate, opt, "prefilterJit", d->prefilterJit);
+  if (prefilterChanged) {
+    std::string err;
+    if (!d->compilePrefilter(d->bpf, &d->prefilter, &err)) {
+      LogMessage msg;
+      msg.level = LogMessage::LEVEL_ERROR;
+      msg.message = err;
+      msg.domain = "pcap";
+      d->log(msg);
+    }
+  }
+}
+
+v8::Local<v8::Object> Session::captureOptions() const {
+  Isolate *isolate = Isolate::GetCurrent();
+  Local<Object> obj = Object::New(isolate);
+  const Pcap &base = *d->pcaps.front();
+  const Pcap::RingOption &ring = base.ringOption();
+  v8pp::set_option(isolate, obj, "backend",
+                   base.backend() == Pcap::BACKEND_RING ? "ring" : "pcap");
+  v8pp::set_option(isolate, obj, "blockSize", ring.blockSize);
+  v8pp::set_option(isolate, obj, "blockCount", ring.blockCount);
+  v8pp::set_option(isolate, obj, "blockTimeout", ring.blockTimeout);
+  v8pp::set_option(isolate, obj, "fanout", ring.fanout);
+  const char *fanoutModes[] = {"hash", "cpu", "lb"};
+  v8pp::set_option(isolate, obj, "fanoutMode", fanoutModes[ring.fanoutMode]);
+  const Pcap::PcapOption &live = base.pcapOption();
+  v8pp::set_option(isolate, obj, "bufferSize", live.bufferSize);
+  v8pp::set_option(isolate, obj, "timeout", live.timeout);
+  v8pp::set_option(isolate, obj, "immediate", live.immediate);
+  v8pp::set_option(isolate, obj, "nanosecond", live.nanosecond);
+  const Pcap::BatchOption &batch = base.batchOption();
+  v8pp::set_option(isolate, obj, "batchSize", batch.size);
+  v8pp::set_option(isolate, obj, "batchTimeout", batch.timeout);
+  v8pp::set_option(isolate, obj, "reorderWindow", d->reorderWindow);
+  const char *overloadPolicies[] = {"block", "drop", "raw", "sample"};
+  v8pp::set_option(isolate, obj, "overloadPolicy",
+                   overloadPolicies[d->overload.policy]);
+  v8pp::set_option(isolate, obj, "queueLimit", d->overload.packetLimit);
+  v8pp::set_option(isolate, obj, "streamQueueLimit", d->overload.streamLimit);
+  v8pp::set_option(isolate, obj, "sampleRate", d->overload.sampleRate);
+  v8pp::set_option(isolate, obj, "flowAffinity",
+                   d->packetDispatcher->flowAffinity());
+  v8pp::set_option(isolate, obj, "prefilterLinkType", d->prefilterLinkType);
+  v8pp::set_option(isolate, obj, "prefilterJit", d->prefilterJit);
+  return obj;
+}
+
+bool Session::setCaptureFile(v8::Local<v8::Object> opt, std::string *error) {
+  Isolate *isolate = Isolate::GetCurrent();
+  CaptureWriter::Context file;
+  v8pp::get_option(isolate, opt, "path", file.path);
+  double rotateSize = 0;
+  v8pp::get_option(isolate, opt, "rotateSize", rotateSize);
+  file.rotateSize = rotateSize;
+  v8pp::get_option(isolate, opt, "rotateInterval", file.rotateInterval);
+  v8pp::get_option(isolate, opt, "maxFiles", file.maxFiles);
+  v8pp::get_option(isolate, opt, "bufferSize", file.bufferSize);
+  v8pp::get_option(isolate, opt, "bufferCount", file.bufferCount);
+  d->captureFile = file;
+
+  if (!d->capturing) {
+    d->closeCaptureWriter();
+    return true;
+  }
+  return d->openCaptureWriter(error);
 }
 
-v8::Local<v8::Object> Session::status() const { return d->status(); }
+v8::Local<v8::Object> Session::captureFile() const {
+  Isolate *isolate = Isolate::GetCurrent();
+  Local<Object> obj = Object::New(isolate);
+  const CaptureWriter::Context &file = d->captureFile;
+  v8pp::set_option(isolate, obj, "path", file.path);
+  v8pp::set_option(isolate, obj, "rotateSize",
+                   static_cast<double>(file.rotateSize));
+  v8pp::set_option(isolate, obj, "rotateInterval", file.rotateInterval);
+  v8pp::set_option(isolate, obj, "maxFiles", file.maxFiles);
+  v8pp::set_option(isolate, obj, "bufferSize", file.bufferSize);
+  v8pp::set_option(isolate, obj, "bufferCount", file.bufferCount);
+  return obj;
+}
+
+v8::Local<v8::Object> Session::status() const { return d->status(false); }
 
 void Session::start() {
-  d->pcap->start();
+  std::string error;
+  if (!d->openCaptureWriter(&error)) {
+    LogMessage msg;
+    msg.level = LogMessage::LEVEL_ERROR;
+    msg.message = error;
+    msg.domain = "capture-file";
+    d->log(msg);
+  }
+  for (const auto &pcap : d->pcaps) {
+    pcap->start();
+  }
   d->capturing = true;
   uv_async_send(&d->statusCbAsync);
 }
 
 void Session::stop() {
-  d->pcap->stop();
+  for (const auto &pcap : d->pcaps) {
+    pcap->stop();
+  }
+  d->closeCaptureWriter();
   d->capturing = false;
   uv_async_send(&d->statusCbAsync);
 }
@@ -309,6 +1177,29 @@ void Session::reset(v8::Local<v8::Object> opt) {
   Isolate *isolate = Isolate::GetCurrent();
   d->prevQueue = 0;
 
+  // Exports read from the store that is about to be replaced; they finish
+  // with a cancellation error.
+  d->exporters.clear();
+
+  // Loaders feed the dispatcher that is about to be replaced.
+  for (const auto &reader : d->readers) {
+    if (!reader->finished()) {
+      LogMessage msg;
+      msg.level = LogMessage::LEVEL_WARN;
+      msg.message = "file loading was interrupted by a session reset";
+      msg.domain = "pcap-file";
+      d->log(msg);
+    }
+  }
+  d->readers.clear();
+  d->replayer.reset();
+  d->stopReanalyze();
+
+  // Capture threads push into the dispatchers that are about to be
+  // replaced, and may be waiting for room in their queues.
+  d->pcaps.clear();
+  d->closeCaptureWriter();
+
   v8pp::get_option(isolate, opt, "namespace", d->ns);
 
   v8::Local<v8::Object> config;
@@ -316,6 +1207,11 @@ void Session::reset(v8::Local<v8::Object> opt) {
     d->config = v8pp::json_str(isolate, config);
   }
 
+  std::string codeCache;
+  if (v8pp::get_option(isolate, opt, "code_cache", codeCache)) {
+    ScriptCache::instance().setDirectory(codeCache);
+  }
+
   d->threads = std::thread::hardware_concurrency();
   v8pp::get_option(isolate, opt, "threads", d->threads);
   d->threads = std::max(1, d->threads - 1);
@@ -331,6 +1227,44 @@ void Session::reset(v8::Local<v8::Object> opt) {
     }
   }
 
+  Local<Array> nativeDissectorArray;
+  std::vector<const NativeDissector *> nativeDissectors;
+  if (v8pp::get_option(isolate, opt, "native_dissectors",
+                       nativeDissectorArray)) {
+    for (uint32_t i = 0; i < nativeDissectorArray->Length(); ++i) {
+      const std::string &name = v8pp::from_v8<std::string>(
+          isolate, nativeDissectorArray->Get(i), "");
+      if (const NativeDissector *native = NativeDissector::find(name)) {
+        nativeDissectors.push_back(native);
+      } else {
+        LogMessage msg;
+        msg.level = LogMessage::LEVEL_WARN;
+        msg.message = "unknown native dissector: " + name;
+        msg.domain = "session";
+        d->log(msg);
+      }
+    }
+  }
+
+  Local<Array> pluginArray;
+  if (v8pp::get_option(isolate, opt, "dissector_plugins", pluginArray)) {
+    for (uint32_t i = 0; i < pluginArray->Length(); ++i) {
+      const std::string &path =
+          v8pp::from_v8<std::string>(isolate, pluginArray->Get(i), "");
+      std::string error;
+      if (const NativeDissector *plugin =
+              NativeDissector::load(path, &error)) {
+        nativeDissectors.push_back(plugin);
+      } else {
+        LogMessage msg;
+        msg.level = LogMessage::LEVEL_ERROR;
+        msg.message = error;
+        msg.domain = "session";
+        d->log(msg);
+      }
+    }
+  }
+
   Local<Array> streamDissectorArray;
   std::vector<Dissector> streamDissectors;
   if (v8pp::get_option(isolate, opt, "stream_dissectors",
@@ -343,6 +1277,11 @@ void Session::reset(v8::Local<v8::Object> opt) {
     }
   }
 
+  // Off by default: errors thrown by snapshot code report the snapshot
+  // source instead of the dissector script.
+  bool startupSnapshot = false;
+  v8pp::get_option(isolate, opt, "startup_snapshot", startupSnapshot);
+
   auto dissCtx = std::make_shared<PacketDispatcher::Context>();
   dissCtx->threads = d->threads;
   dissCtx->config = d->config;
@@ -356,6 +1295,8 @@ void Session::reset(v8::Local<v8::Object> opt) {
       d->streamDispatcher->insert(seq, std::move(streams));
   };
   dissCtx->dissectors.swap(dissectors);
+  dissCtx->nativeDissectors.swap(nativeDissectors);
+  dissCtx->startupSnapshot = startupSnapshot;
   dissCtx->logCb = std::bind(&Private::log, std::ref(d), std::placeholders::_1);
   d->packetDispatcher.reset(new PacketDispatcher(dissCtx));
 
@@ -363,6 +1304,7 @@ void Session::reset(v8::Local<v8::Object> opt) {
   streamCtx->threads = d->threads;
   streamCtx->config = d->config;
   streamCtx->dissectors.swap(streamDissectors);
+  streamCtx->startupSnapshot = startupSnapshot;
   streamCtx->logCb =
       std::bind(&Private::log, std::ref(d), std::placeholders::_1);
   streamCtx->streamsCb = [this](
@@ -370,19 +1312,22 @@ void Session::reset(v8::Local<v8::Object> opt) {
     d->streamDispatcher->insert(std::move(streams));
   };
   streamCtx->vpLayersCb = [this](std::vector<std::unique_ptr<Layer>> layers) {
+    std::vector<std::unique_ptr<Packet>> packets;
     for (auto &layer : layers) {
-      d->packetDispatcher->analyze(
-          std::unique_ptr<Packet>(new Packet(std::move(layer))));
+      packets.emplace_back(new Packet(std::move(layer)));
     }
+    if (!packets.empty())
+      d->packetDispatcher->analyze(std::move(packets));
   };
   d->streamDispatcher.reset(new StreamDispatcher(streamCtx));
+  d->packetDispatcher->setOverloadOption(d->overload);
+  d->packetDispatcher->setFlowAffinity(d->flowAffinity);
+  d->streamDispatcher->setOverloadOption(d->overload);
 
-  auto pcapCtx = std::make_shared<Pcap::Context>();
-  pcapCtx->logCb = std::bind(&Private::log, std::ref(d), std::placeholders::_1);
-  pcapCtx->packetCb = [this](std::unique_ptr<Packet> pkt) {
-    analyze(std::move(pkt));
-  };
-  d->pcap.reset(new Pcap(pcapCtx));
+  d->pcaps.push_back(d->createPcap(0));
+  d->bpf.clear();
+  d->prefilter.reset();
+  d->updateReorderWindow();
 
   std::vector<std::shared_ptr<Packet>> packets;
   if (d->store) {
@@ -401,11 +1346,15 @@ void Session::reset(v8::Local<v8::Object> opt) {
     filter(pair.first, pair.second);
   }
 
+  std::vector<std::unique_ptr<Packet>> replay;
   for (const auto &pkt : packets) {
     if (!pkt->vpacket()) {
-      analyze(pkt->shallowClone());
+      replay.push_back(pkt->shallowClone());
     }
   }
+  if (!replay.empty())
+    d->reanalyzeThread =
+        std::thread(&Private::reanalyze, d, std::move(replay));
 
   uv_async_send(&d->statusCbAsync);
 }
@@ -4,6 +4,7 @@
 #include <memory>
 #include <string>
 #include <v8.h>
+#include <vector>
 
 class Packet;
 
@@ -17,11 +18,25 @@ public:
   v8::Local<v8::Function> logCallback() const;
   void setLogCallback(const v8::Local<v8::Function> &cb);
 
+  v8::Local<v8::Function> exportCallback() const;
+  void setExportCallback(const v8::Local<v8::Function> &cb);
+
   v8::Local<v8::Function> statusCallback() const;
   void setStatusCallback(const v8::Local<v8::Function> &cb);
 
   void analyze(std::unique_ptr<Packet> pkt);
   void analyze(std::vector<std::unique_ptr<Packet>> packets);
+  bool analyzeBuffer(v8::Local<v8::Value> buffer, v8::Local<v8::Object> table,
+                     std::string *error);
+  bool analyzeRaw(v8::Local<v8::Value> buffer, v8::Local<v8::Object> opt,
+                  size_t *consumed, std::string *error);
+  bool load(const std::string &path, std::string *error);
+  bool replay(const std::string &path, v8::Local<v8::Object> opt,
+              std::string *error);
+  void stopReplay();
+  v8::Local<v8::Object> replayStatus() const;
+  bool exportPackets(const std::string &path, v8::Local<v8::Object> opt,
+                     std::string *error);
   void filter(const std::string &name, const std::string &filter);
   std::shared_ptr<const Packet> get(uint32_t seq) const;
   std::vector<uint32_t> getFiltered(const std::string &name, uint32_t start,
@@ -33,11 +48,17 @@ public:
   static v8::Local<v8::Array> devices();
   void setInterface(const std::string &ifs);
   std::string networkInterface() const;
+  void setInterfaces(const std::vector<std::string> &list);
+  std::vector<std::string> interfaces() const;
   void setPromiscuous(bool promisc);
   bool promiscuous() const;
   void setSnaplen(int len);
   int snaplen() const;
   bool setBPF(const std::string &filter, std::string *error);
+  void setCaptureOptions(v8::Local<v8::Object> opt);
+  v8::Local<v8::Object> captureOptions() const;
+  bool setCaptureFile(v8::Local<v8::Object> opt, std::string *error);
+  v8::Local<v8::Object> captureFile() const;
   v8::Local<v8::Object> status() const;
 
   void start();
@@ -104,7 +104,7 @@ public:
       if (wrapper->layersCache.IsEmpty()) {
         obj = v8::Object::New(isolate);
         for (const auto &pair : layer->layers()) {
-          obj->Set(v8pp::to_v8(isolate, pair.first),
+          obj->Set(v8pp::to_v8(isolate, pair.first.str()),
                    SessionLayerWrapper::create(pair.second));
         }
         wrapper->layersCache = v8::UniquePersistent<v8::Object>(isolate, obj);
@@ -27,6 +27,8 @@ public:
     Nan::SetAccessor(otl, Nan::New("ts_sec").ToLocalChecked(), ts_sec);
     Nan::SetAccessor(otl, Nan::New("ts_nsec").ToLocalChecked(), ts_nsec);
     Nan::SetAccessor(otl, Nan::New("length").ToLocalChecked(), length);
+    Nan::SetAccessor(otl, Nan::New("interfaceIndex").ToLocalChecked(),
+                     interfaceIndex);
     Nan::SetAccessor(otl, Nan::New("summary").ToLocalChecked(), summary);
     Nan::SetAccessor(otl, Nan::New("payload").ToLocalChecked(), payload);
     Nan::SetAccessor(otl, Nan::New("layers").ToLocalChecked(), layers);
@@ -68,6 +70,13 @@ public:
       info.GetReturnValue().Set(pkt->length());
   }
 
+  static NAN_GETTER(interfaceIndex) {
+    SessionPacketWrapper *obj =
+        ObjectWrap::Unwrap<SessionPacketWrapper>(info.Holder());
+    if (const std::shared_ptr<const Packet> &pkt = obj->pkt.lock())
+      info.GetReturnValue().Set(pkt->interfaceIndex());
+  }
+
   static NAN_GETTER(payload) {
     v8::Isolate *isolate = v8::Isolate::GetCurrent();
     SessionPacketWrapper *wrapper =
@@ -110,7 +119,7 @@ public:
       if (wrapper->layersCache.IsEmpty()) {
         obj = v8::Object::New(isolate);
         for (const auto &pair : pkt->layers()) {
-          obj->Set(v8pp::to_v8(isolate, pair.first),
+          obj->Set(v8pp::to_v8(isolate, pair.first.str()),
                    SessionLayerWrapper::create(pair.second));
         }
         wrapper->layersCache = v8::UniquePersistent<v8::Object>(isolate, obj);
@@ -159,13 +168,14 @@ public:
         ObjectWrap::Unwrap<SessionPacketWrapper>(info.Holder());
 
     if (const std::shared_ptr<const Packet> &pkt = wrapper->pkt.lock()) {
-      const std::string &id = v8pp::from_v8<std::string>(isolate, info[0], "");
+      const Atom id =
+          Atom::find(v8pp::from_v8<std::string>(isolate, info[0], ""));
 
       std::function<std::shared_ptr<Item>(
-          const std::unordered_map<std::string, std::shared_ptr<Layer>> &)>
+          const std::unordered_map<Atom, std::shared_ptr<Layer>> &)>
           findItem = [id, &findItem](
-              const std::unordered_map<std::string, std::shared_ptr<Layer>>
-                  &layers) -> std::shared_ptr<Item> {
+              const std::unordered_map<Atom, std::shared_ptr<Layer>> &layers)
+          -> std::shared_ptr<Item> {
 
         if (layers.empty())
           return std::shared_ptr<Item>();
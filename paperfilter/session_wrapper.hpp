@@ -19,6 +19,12 @@ public:
     tpl->InstanceTemplate()->SetInternalFieldCount(1);
     tpl->SetClassName(Nan::New("Session").ToLocalChecked());
     SetPrototypeMethod(tpl, "analyze", analyze);
+    SetPrototypeMethod(tpl, "analyzeBuffer", analyzeBuffer);
+    SetPrototypeMethod(tpl, "analyzeRaw", analyzeRaw);
+    SetPrototypeMethod(tpl, "load", load);
+    SetPrototypeMethod(tpl, "replay", replay);
+    SetPrototypeMethod(tpl, "stopReplay", stopReplay);
+    SetPrototypeMethod(tpl, "export", exportPackets);
     SetPrototypeMethod(tpl, "filter", filter);
     SetPrototypeMethod(tpl, "get", get);
     SetPrototypeMethod(tpl, "getFiltered", getFiltered);
@@ -27,14 +33,24 @@ public:
                      setLogCallback);
     Nan::SetAccessor(otl, Nan::New("statusCallback").ToLocalChecked(),
                      statusCallback, setStatusCallback);
+    Nan::SetAccessor(otl, Nan::New("exportCallback").ToLocalChecked(),
+                     exportCallback, setExportCallback);
     Nan::SetAccessor(otl, Nan::New("namespace").ToLocalChecked(), ns);
     Nan::SetAccessor(otl, Nan::New("interface").ToLocalChecked(),
                      networkInterface, setInterface);
+    Nan::SetAccessor(otl, Nan::New("interfaces").ToLocalChecked(), interfaces,
+                     setInterfaces);
     Nan::SetAccessor(otl, Nan::New("promiscuous").ToLocalChecked(), promiscuous,
                      setPromiscuous);
     Nan::SetAccessor(otl, Nan::New("snaplen").ToLocalChecked(), snaplen,
                      setSnaplen);
+    Nan::SetAccessor(otl, Nan::New("captureOptions").ToLocalChecked(),
+                     captureOptions, setCaptureOptions);
+    Nan::SetAccessor(otl, Nan::New("captureFile").ToLocalChecked(),
+                     captureFile, setCaptureFile);
     Nan::SetAccessor(otl, Nan::New("status").ToLocalChecked(), status);
+    Nan::SetAccessor(otl, Nan::New("replayStatus").ToLocalChecked(),
+                     replayStatus);
     SetPrototypeMethod(tpl, "setBPF", setBPF);
     SetPrototypeMethod(tpl, "start", start);
     SetPrototypeMethod(tpl, "stop", stop);
@@ -75,6 +91,90 @@ public:
     }
   }
 
+  static NAN_METHOD(analyzeBuffer) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    if (!info[1]->IsObject()) {
+      Nan::ThrowTypeError("table must be an object");
+      return;
+    }
+    std::string err;
+    if (!wrapper->session->analyzeBuffer(info[0], info[1].As<v8::Object>(),
+                                         &err)) {
+      Nan::ThrowError(err.c_str());
+    }
+  }
+
+  static NAN_METHOD(analyzeRaw) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    v8::Local<v8::Object> opt = Nan::New<v8::Object>();
+    if (info[1]->IsObject())
+      opt = info[1].As<v8::Object>();
+    size_t consumed = 0;
+    std::string err;
+    if (!wrapper->session->analyzeRaw(info[0], opt, &consumed, &err)) {
+      Nan::ThrowError(err.c_str());
+      return;
+    }
+    info.GetReturnValue().Set(static_cast<double>(consumed));
+  }
+
+  static NAN_METHOD(load) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    const std::string &path = *Nan::Utf8String(info[0]);
+    std::string err;
+    if (!wrapper->session->load(path, &err)) {
+      Nan::ThrowError(err.c_str());
+    }
+  }
+
+  static NAN_METHOD(replay) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    const std::string &path = *Nan::Utf8String(info[0]);
+    v8::Local<v8::Object> opt = info[1]->IsObject()
+                                    ? info[1].As<v8::Object>()
+                                    : Nan::New<v8::Object>();
+    std::string err;
+    if (!wrapper->session->replay(path, opt, &err)) {
+      Nan::ThrowError(err.c_str());
+    }
+  }
+
+  static NAN_METHOD(stopReplay) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    wrapper->session->stopReplay();
+  }
+
+  static NAN_GETTER(replayStatus) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    info.GetReturnValue().Set(wrapper->session->replayStatus());
+  }
+
+  static NAN_METHOD(exportPackets) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    const std::string &path = *Nan::Utf8String(info[0]);
+    v8::Local<v8::Object> opt = info[1]->IsObject()
+                                    ? info[1].As<v8::Object>()
+                                    : Nan::New<v8::Object>();
+    std::string err;
+    if (!wrapper->session->exportPackets(path, opt, &err)) {
+      Nan::ThrowError(err.c_str());
+    }
+  }
+
   static NAN_METHOD(filter) {
     SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
     if (!wrapper->session)
@@ -102,6 +202,22 @@ public:
     }
   }
 
+  static NAN_GETTER(exportCallback) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    info.GetReturnValue().Set(wrapper->session->exportCallback());
+  }
+
+  static NAN_SETTER(setExportCallback) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    if (!value.IsEmpty() && value->IsFunction()) {
+      wrapper->session->setExportCallback(value.As<v8::Function>());
+    }
+  }
+
   static NAN_GETTER(statusCallback) {
     SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
     if (!wrapper->session)
@@ -183,6 +299,30 @@ public:
     wrapper->session->setInterface(*Nan::Utf8String(value));
   }
 
+  static NAN_GETTER(interfaces) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    const std::vector<std::string> &list = wrapper->session->interfaces();
+    v8::Local<v8::Array> array = Nan::New<v8::Array>(list.size());
+    for (size_t i = 0; i < list.size(); ++i) {
+      Nan::Set(array, i, Nan::New<v8::String>(list[i]).ToLocalChecked());
+    }
+    info.GetReturnValue().Set(array);
+  }
+
+  static NAN_SETTER(setInterfaces) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session || !value->IsArray())
+      return;
+    v8::Local<v8::Array> array = value.As<v8::Array>();
+    std::vector<std::string> list;
+    for (uint32_t i = 0; i < array->Length(); ++i) {
+      list.push_back(*Nan::Utf8String(Nan::Get(array, i).ToLocalChecked()));
+    }
+    wrapper->session->setInterfaces(list);
+  }
+
   static NAN_GETTER(promiscuous) {
     SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
     if (!wrapper->session)
@@ -222,6 +362,39 @@ public:
     }
   }
 
+  static NAN_GETTER(captureOptions) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    info.GetReturnValue().Set(wrapper->session->captureOptions());
+  }
+
+  static NAN_SETTER(setCaptureOptions) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session || !value->IsObject())
+      return;
+    wrapper->session->setCaptureOptions(value.As<v8::Object>());
+  }
+
+  static NAN_GETTER(captureFile) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    info.GetReturnValue().Set(wrapper->session->captureFile());
+  }
+
+  static NAN_SETTER(setCaptureFile) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    v8::Local<v8::Object> opt =
+        value->IsObject() ? value.As<v8::Object>() : Nan::New<v8::Object>();
+    std::string err;
+    if (!wrapper->session->setCaptureFile(opt, &err)) {
+      Nan::ThrowError(err.c_str());
+    }
+  }
+
   static NAN_GETTER(status) {
     SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
     if (!wrapper->session)
@@ -0,0 +1,95 @@
+#include "startup_snapshot.hpp"
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <v8pp/convert.hpp>
+
+namespace {
+const char *const globalName = "__dripcapDissectors";
+const size_t maxSnapshots = 4;
+
+struct Entry {
+  std::string source;
+  std::shared_ptr<const StartupSnapshot> snapshot;
+};
+
+// Each script becomes a function with the same body as the wrapper that the
+// dissector threads compile. Parenthesizing them makes V8 compile them
+// eagerly while the snapshot is built.
+std::string embeddedSource(const std::vector<Dissector> &dissectors) {
+  std::string source = std::string("var ") + globalName + " = [\n";
+  for (const Dissector &diss : dissectors) {
+    source += "(function(){" + diss.script + "\n}),\n";
+  }
+  source += "];\n";
+  return source;
+}
+}
+
+class StartupSnapshot::Private {
+public:
+  v8::StartupData blob;
+  size_t count = 0;
+};
+
+StartupSnapshot::StartupSnapshot() : d(new Private()) {
+  d->blob.data = nullptr;
+  d->blob.raw_size = 0;
+}
+
+StartupSnapshot::~StartupSnapshot() { delete[] d->blob.data; }
+
+std::shared_ptr<const StartupSnapshot>
+StartupSnapshot::get(const std::vector<Dissector> &dissectors) {
+  static std::mutex mutex;
+  static std::vector<Entry> entries;
+
+  const std::string &source = embeddedSource(dissectors);
+
+  // Held while building, so that the other threads of a session wait for the
+  // first one instead of building the same snapshot again.
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = std::find_if(entries.begin(), entries.end(),
+                         [&source](const Entry &entry) {
+                           return entry.source == source;
+                         });
+  if (it != entries.end()) {
+    std::rotate(it, it + 1, entries.end());
+    return entries.back().snapshot;
+  }
+
+  std::shared_ptr<StartupSnapshot> snapshot(new StartupSnapshot());
+  snapshot->d->blob = v8::V8::CreateSnapshotDataBlob(source.c_str());
+  snapshot->d->count = dissectors.size();
+  if (!snapshot->d->blob.data || snapshot->d->blob.raw_size <= 0)
+    snapshot.reset();
+
+  if (entries.size() >= maxSnapshots)
+    entries.erase(entries.begin());
+  Entry entry;
+  entry.source = source;
+  entry.snapshot = snapshot;
+  entries.push_back(entry);
+  return snapshot;
+}
+
+v8::StartupData *StartupSnapshot::blob() const { return &d->blob; }
+
+bool StartupSnapshot::run(v8::Isolate *isolate, size_t index) const {
+  if (index >= d->count)
+    return false;
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+  v8::Local<v8::Value> list =
+      context->Global()->Get(v8pp::to_v8(isolate, globalName));
+  if (list.IsEmpty() || !list->IsArray())
+    return false;
+  v8::Local<v8::Value> func = list.As<v8::Array>()->Get(index);
+  if (func.IsEmpty() || !func->IsFunction())
+    return false;
+  // The caller compiles the script again if it throws, so that the error
+  // points into the script rather than into the snapshot source.
+  v8::TryCatch try_catch;
+  return !func.As<v8::Function>()
+              ->Call(context, context->Global(), 0, nullptr)
+              .IsEmpty();
+}
@@ -0,0 +1,40 @@
+#ifndef STARTUP_SNAPSHOT_HPP
+#define STARTUP_SNAPSHOT_HPP
+
+#include "dissector.hpp"
+#include <memory>
+#include <v8.h>
+#include <vector>
+
+// V8 startup snapshot holding a set of dissector scripts, each compiled into
+// a function that isolates created from the snapshot call instead of
+// compiling the script. The native bindings are still installed per isolate
+// by PaperContext; V8 5.3 cannot serialize templates that point to C++
+// callbacks.
+class StartupSnapshot {
+public:
+  // Snapshots are shared by every thread asking for the same scripts. Returns
+  // nullptr when V8 cannot build one, e.g. when a script does not compile.
+  static std::shared_ptr<const StartupSnapshot>
+  get(const std::vector<Dissector> &dissectors);
+
+  ~StartupSnapshot();
+  StartupSnapshot(const StartupSnapshot &) = delete;
+  StartupSnapshot &operator=(const StartupSnapshot &) = delete;
+
+  // Must outlive every isolate created from it.
+  v8::StartupData *blob() const;
+
+  // Runs the script at index in the current context. Returns false if the
+  // context was not created from this snapshot or the script threw.
+  bool run(v8::Isolate *isolate, size_t index) const;
+
+private:
+  StartupSnapshot();
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
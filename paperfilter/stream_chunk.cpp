@@ -42,6 +42,14 @@ StreamChunk::StreamChunk(v8::Local<v8::Object> obj)
   }
 }
 
+StreamChunk::StreamChunk(const std::string &ns, const std::string &id,
+                         const std::shared_ptr<Layer> &layer)
+    : d(std::make_shared<Private>()) {
+  d->ns = ns;
+  d->id = id;
+  d->layer = layer;
+}
+
 StreamChunk::StreamChunk(const StreamChunk &stream) : d(stream.d) {}
 
 StreamChunk::~StreamChunk() {}
@@ -69,6 +77,10 @@ void StreamChunk::setAttr(const std::string &name, v8::Local<v8::Value> obj) {
   }
 }
 
+void StreamChunk::setAttr(const std::string &name, const ItemValue &value) {
+  d->attrs.emplace(name, value);
+}
+
 std::unordered_map<std::string, ItemValue> StreamChunk::attrs() const {
   return d->attrs;
 }
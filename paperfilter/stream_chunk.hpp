@@ -12,6 +12,8 @@ class Layer;
 class StreamChunk {
 public:
   StreamChunk(v8::Local<v8::Object> obj);
+  StreamChunk(const std::string &ns, const std::string &id,
+              const std::shared_ptr<Layer> &layer);
   StreamChunk(const StreamChunk &stream);
   ~StreamChunk();
   StreamChunk &operator=(const StreamChunk &) = delete;
@@ -20,6 +22,7 @@ public:
   std::shared_ptr<Layer> layer() const;
   void setLayer(const std::shared_ptr<Layer> &layer);
   void setAttr(const std::string &name, v8::Local<v8::Value> obj);
+  void setAttr(const std::string &name, const ItemValue &value);
   std::unordered_map<std::string, ItemValue> attrs() const;
   void setEnd(bool end);
   bool end() const;
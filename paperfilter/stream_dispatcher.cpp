@@ -1,6 +1,7 @@
 #include "stream_dispatcher.hpp"
 #include "stream_chunk.hpp"
 #include "stream_dissector_thread.hpp"
+#include <algorithm>
 #include <chrono>
 #include <map>
 #include <mutex>
@@ -18,6 +19,7 @@ struct Stream {
 class StreamDispatcher::Private {
 public:
   Private(const std::shared_ptr<Context> &ctx);
+  bool admit(const StreamDissectorThread &thread);
 
 public:
   std::shared_ptr<Context> ctx;
@@ -26,6 +28,10 @@ public:
   std::map<uint32_t, std::vector<std::unique_ptr<StreamChunk>>> streamChunks;
   std::unordered_map<std::string, Stream> streams;
   uint32_t maxSeq = 0;
+
+  OverloadOption overload;
+  OverloadStats overloadStats;
+  uint64_t sampleCounter = 0;
 };
 
 StreamDispatcher::Private::Private(const std::shared_ptr<Context> &ctx)
@@ -37,11 +43,27 @@ StreamDispatcher::Private::Private(const std::shared_ptr<Context> &ctx)
   dissCtx->streamsCb = ctx->streamsCb;
   dissCtx->logCb = ctx->logCb;
   dissCtx->dissectors = ctx->dissectors;
+  dissCtx->startupSnapshot = ctx->startupSnapshot;
   for (int i = 0; i < ctx->threads; ++i) {
     dissectorThreads.emplace_back(new StreamDissectorThread(dissCtx));
   }
 }
 
+bool StreamDispatcher::Private::admit(const StreamDissectorThread &thread) {
+  if (thread.queueSize() < overload.streamLimit)
+    return true;
+  // Stream threads feed chunks back into this dispatcher, so waiting here
+  // could deadlock; every policy but sampling drops the chunk.
+  if (overload.policy == OverloadOption::POLICY_SAMPLE) {
+    if (sampleCounter++ % overload.sampleRate == 0)
+      return true;
+    ++overloadStats.sampled;
+  } else {
+    ++overloadStats.dropped;
+  }
+  return false;
+}
+
 StreamDispatcher::StreamDispatcher(const std::shared_ptr<Context> &ctx)
     : d(std::make_shared<Private>(ctx)) {}
 
@@ -67,7 +89,8 @@ void StreamDispatcher::insert(
       }
       stream.lastUsed = std::chrono::system_clock::now();
       StreamDissectorThread &thread = *d->dissectorThreads[stream.thread];
-      thread.insert(std::move(chunk));
+      if (d->admit(thread))
+        thread.insert(std::move(chunk));
     }
   }
   d->streamChunks.erase(d->streamChunks.begin(), it);
@@ -89,7 +112,8 @@ void StreamDispatcher::insert(
     }
     stream.lastUsed = std::chrono::system_clock::now();
     StreamDissectorThread &thread = *d->dissectorThreads[stream.thread];
-    thread.insert(std::move(chunk));
+    if (d->admit(thread))
+      thread.insert(std::move(chunk));
     if (end) {
       d->streams.erase(id);
     }
@@ -102,5 +126,16 @@ uint32_t StreamDispatcher::queueSize() const {
   for (const auto &thread : d->dissectorThreads) {
     size += thread->queueSize();
   }
-  return d->streamChunks.size();
+  return size;
+}
+
+void StreamDispatcher::setOverloadOption(const OverloadOption &option) {
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->overload = option;
+  d->overload.sampleRate = std::max(option.sampleRate, 1u);
+}
+
+OverloadStats StreamDispatcher::overloadStats() const {
+  std::lock_guard<std::mutex> lock(d->mutex);
+  return d->overloadStats;
 }
@@ -2,6 +2,7 @@
 #define STREAM_DISPATCHER_HPP
 
 #include "dissector.hpp"
+#include "overload.hpp"
 #include <functional>
 #include <memory>
 #include <vector>
@@ -16,6 +17,7 @@ public:
     int threads;
     std::string config;
     std::vector<Dissector> dissectors;
+    bool startupSnapshot = false;
     std::function<void(const LogMessage &)> logCb;
     std::function<void(std::vector<std::unique_ptr<StreamChunk>>)> streamsCb;
     std::function<void(std::vector<std::unique_ptr<Layer>>)> vpLayersCb;
@@ -30,6 +32,8 @@ public:
               std::vector<std::unique_ptr<StreamChunk>> streamChunks);
   void insert(std::vector<std::unique_ptr<StreamChunk>> streamChunks);
   uint32_t queueSize() const;
+  void setOverloadOption(const OverloadOption &option);
+  OverloadStats overloadStats() const;
 
 private:
   class Private;
@@ -1,8 +1,11 @@
 #include "stream_dissector_thread.hpp"
 #include "log_message.hpp"
 #include "layer.hpp"
+#include "namespace_matcher.hpp"
 #include "packet.hpp"
 #include "paper_context.hpp"
+#include "script_cache.hpp"
+#include "startup_snapshot.hpp"
 #include "stream_chunk.hpp"
 #include "console.hpp"
 #include <condition_variable>
@@ -31,9 +34,9 @@ public:
   virtual void Free(void *data, size_t) { free(data); }
 };
 
+const size_t maxCachedNamespaces = 1024;
+
 struct DissectorFunc {
-  std::vector<std::string> namespaces;
-  std::vector<std::regex> regexNamespaces;
   v8::UniquePersistent<v8::Function> func;
 };
 }
@@ -43,8 +46,7 @@ public:
   Private(const std::shared_ptr<Context> &ctx);
   ~Private();
   const std::vector<const DissectorFunc *> &findDessector(
-      const std::string &ns,
-      const std::unordered_map<std::string, DissectorFunc> &dissectors,
+      const std::string &ns, const std::vector<DissectorFunc> &dissectors,
       std::unordered_map<std::string, std::vector<const DissectorFunc *>>
           *nsMap);
 
@@ -63,8 +65,13 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
 
   thread = std::thread([this]() {
     Context &ctx = *this->ctx;
+    std::shared_ptr<const StartupSnapshot> snapshot;
+    if (ctx.startupSnapshot)
+      snapshot = StartupSnapshot::get(ctx.dissectors);
     v8::Isolate::CreateParams create_params;
     create_params.array_buffer_allocator = new ArrayBufferAllocator();
+    if (snapshot)
+      create_params.snapshot_blob = snapshot->blob();
     v8::Isolate *isolate = v8::Isolate::New(create_params);
 
     // workaround for chromium task runner
@@ -86,19 +93,26 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
           isolate, ctx.logCb, "stream_dissector");
       ppctx.set("console", console);
 
-      std::unordered_map<std::string, DissectorFunc> dissectors;
+      std::vector<DissectorFunc> dissectors(ctx.dissectors.size());
+      std::vector<NamespaceMatcher::Pattern> patterns(ctx.dissectors.size());
       std::unordered_map<std::string, std::vector<const DissectorFunc *>> nsMap;
 
-      for (const Dissector &diss : ctx.dissectors) {
+      for (size_t i = 0; i < ctx.dissectors.size(); ++i) {
+        const Dissector &diss = ctx.dissectors[i];
         v8::Local<v8::Object> moduleObj = v8::Object::New(isolate);
         ppctx.set("module", moduleObj);
 
         v8::Local<v8::Function> func;
-        Nan::MaybeLocal<Nan::BoundScript> script = Nan::CompileScript(
-            v8pp::to_v8(isolate, "(function(){" + diss.script + "})()"),
-            v8::ScriptOrigin(v8pp::to_v8(isolate, diss.resourceName)));
-        if (!script.IsEmpty()) {
-          Nan::RunScript(script.ToLocalChecked());
+        bool loaded = snapshot && snapshot->run(isolate, i);
+        if (!loaded) {
+          v8::MaybeLocal<v8::Script> script = ScriptCache::instance().compile(
+              isolate, "(function(){" + diss.script + "})()",
+              diss.resourceName);
+          // A script that throws is reported through try_catch below.
+          loaded = !script.IsEmpty() &&
+                   !Nan::RunScript(script.ToLocalChecked()).IsEmpty();
+        }
+        if (loaded) {
           v8::Local<v8::Value> result =
               moduleObj->Get(v8::String::NewFromUtf8(isolate, "exports"));
 
@@ -124,28 +138,29 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
           }
         } else {
           v8::Local<v8::Array> namespaces;
-          std::vector<std::string> stringNamespaces;
-          std::vector<std::regex> regexNamespaces;
+          NamespaceMatcher::Pattern &pattern = patterns[i];
 
           if (v8pp::get_option(isolate, func, "namespaces", namespaces)) {
-            for (uint32_t i = 0; i < namespaces->Length(); ++i) {
-              v8::Local<v8::Value> ns = namespaces->Get(i);
+            for (uint32_t j = 0; j < namespaces->Length(); ++j) {
+              v8::Local<v8::Value> ns = namespaces->Get(j);
               if (ns->IsString()) {
-                stringNamespaces.push_back(
+                pattern.strings.push_back(
                     v8pp::from_v8<std::string>(isolate, ns, ""));
               } else if (ns->IsRegExp()) {
-                regexNamespaces.push_back(std::regex(v8pp::from_v8<std::string>(
-                    isolate, ns.As<v8::RegExp>()->GetSource(), "")));
+                pattern.regexes.push_back(v8pp::from_v8<std::string>(
+                    isolate, ns.As<v8::RegExp>()->GetSource(), ""));
               }
             }
           }
 
-          dissectors[diss.resourceName] = {
-              stringNamespaces, regexNamespaces,
-              v8::UniquePersistent<v8::Function>(isolate, func)};
+          dissectors[i].func.Reset(isolate, func);
         }
       }
 
+      std::call_once(ctx.matcherFlag, [&ctx, &patterns]() {
+        ctx.matcher = std::make_shared<NamespaceMatcher>(patterns);
+      });
+
       std::unordered_map<
           std::string, std::vector<v8::UniquePersistent<v8::Object>>> instances;
 
@@ -281,35 +296,21 @@ StreamDissectorThread::Private::~Private() {
 
 const std::vector<const DissectorFunc *> &
 StreamDissectorThread::Private::findDessector(
-    const std::string &ns,
-    const std::unordered_map<std::string, DissectorFunc> &dissectors,
+    const std::string &ns, const std::vector<DissectorFunc> &dissectors,
     std::unordered_map<std::string, std::vector<const DissectorFunc *>>
         *nsMap) {
-  static const std::vector<DissectorFunc *> null;
-
   auto it = nsMap->find(ns);
   if (it != nsMap->end())
     return it->second;
 
+  if (nsMap->size() >= maxCachedNamespaces)
+    nsMap->clear();
+
   std::vector<const DissectorFunc *> &funcs = (*nsMap)[ns];
-  for (const auto &pair : dissectors) {
-    const auto &diss = pair.second;
-    for (const std::string &dissNs : diss.namespaces) {
-      if (dissNs == ns) {
-        funcs.push_back(&diss);
-        break;
-      }
-    }
-    if (funcs.empty()) {
-      for (const std::regex &regex : diss.regexNamespaces) {
-        if (std::regex_match(ns, regex)) {
-          funcs.push_back(&diss);
-          break;
-        }
-      }
-    }
+  for (size_t index : *ctx->matcher->match(ns)) {
+    if (index < dissectors.size() && !dissectors[index].func.IsEmpty())
+      funcs.push_back(&dissectors[index]);
   }
-
   return funcs;
 }
 
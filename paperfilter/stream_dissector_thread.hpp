@@ -4,10 +4,12 @@
 #include "dissector.hpp"
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 class StreamChunk;
+class NamespaceMatcher;
 class Layer;
 struct LogMessage;
 
@@ -16,9 +18,14 @@ public:
   struct Context {
     std::string config;
     std::vector<Dissector> dissectors;
+    bool startupSnapshot = false;
     std::function<void(const LogMessage &)> logCb;
     std::function<void(std::vector<std::unique_ptr<StreamChunk>>)> streamsCb;
     std::function<void(std::vector<std::unique_ptr<Layer>>)> vpLayersCb;
+
+    // Built by the first thread that has loaded the dissectors.
+    std::once_flag matcherFlag;
+    std::shared_ptr<const NamespaceMatcher> matcher;
   };
 
 public:
@@ -11,6 +11,10 @@ public:
   std::string networkInterface;
   bool promiscuous = false;
   int snaplen = 2048;
+  Backend backend = BACKEND_PCAP;
+  RingOption ringOption;
+  PcapOption pcapOption;
+  BatchOption batchOption;
 };
 
 Pcap::Private::Private(const std::shared_ptr<Context> &ctx) : ctx(ctx) {}
@@ -24,6 +28,12 @@ std::vector<Pcap::Device> Pcap::devices() {
   return devs;
 }
 
+bool Pcap::compile(const std::string &filter, int linkType, int snaplen,
+                   std::vector<Instruction> *program, std::string *error) {
+  program->clear();
+  return true;
+}
+
 void Pcap::setInterface(const std::string &ifs) { d->networkInterface = ifs; }
 
 std::string Pcap::networkInterface() const { return d->networkInterface; }
@@ -40,6 +50,26 @@ bool Pcap::setBPF(const std::string &filter, std::string *error) {
   return true;
 }
 
+void Pcap::setBackend(Backend backend) { d->backend = backend; }
+
+Pcap::Backend Pcap::backend() const { return d->backend; }
+
+void Pcap::setRingOption(const RingOption &option) { d->ringOption = option; }
+
+Pcap::RingOption Pcap::ringOption() const { return d->ringOption; }
+
+void Pcap::setPcapOption(const PcapOption &option) { d->pcapOption = option; }
+
+Pcap::PcapOption Pcap::pcapOption() const { return d->pcapOption; }
+
+void Pcap::setBatchOption(const BatchOption &option) {
+  d->batchOption = option;
+}
+
+Pcap::BatchOption Pcap::batchOption() const { return d->batchOption; }
+
+Pcap::Stats Pcap::stats() const { return Stats(); }
+
 void Pcap::start() {}
 
 void Pcap::stop() {}
@@ -0,0 +1,44 @@
+#include "work_deque.hpp"
+#include "packet.hpp"
+
+WorkDeque::WorkDeque() : count(0) {}
+
+WorkDeque::~WorkDeque() {}
+
+void WorkDeque::push(std::vector<std::unique_ptr<Packet>> *packets) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &pkt : *packets) {
+    this->packets.push_back(std::move(pkt));
+  }
+  packets->clear();
+  count = this->packets.size();
+}
+
+bool WorkDeque::pop(std::unique_ptr<Packet> *pkt) {
+  if (count == 0)
+    return false;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (packets.empty())
+    return false;
+  *pkt = std::move(packets.front());
+  packets.pop_front();
+  count = packets.size();
+  return true;
+}
+
+size_t WorkDeque::steal(std::vector<std::unique_ptr<Packet>> *packets) {
+  if (count == 0)
+    return 0;
+  std::lock_guard<std::mutex> lock(mutex);
+  // Half rounded up, so that a single waiting packet can be taken too.
+  size_t n = (this->packets.size() + 1) / 2;
+  size_t first = this->packets.size() - n;
+  for (size_t i = first; i < this->packets.size(); ++i) {
+    packets->push_back(std::move(this->packets[i]));
+  }
+  this->packets.resize(first);
+  count = this->packets.size();
+  return n;
+}
+
+size_t WorkDeque::size() const { return count; }
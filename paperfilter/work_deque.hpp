@@ -0,0 +1,31 @@
+#ifndef WORK_DEQUE_HPP
+#define WORK_DEQUE_HPP
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class Packet;
+
+// Packets taken by one dissector thread. The owner works from the front;
+// idle threads steal from the back.
+class WorkDeque {
+public:
+  WorkDeque();
+  ~WorkDeque();
+  WorkDeque(const WorkDeque &) = delete;
+  WorkDeque &operator=(const WorkDeque &) = delete;
+  void push(std::vector<std::unique_ptr<Packet>> *packets);
+  bool pop(std::unique_ptr<Packet> *pkt);
+  size_t steal(std::vector<std::unique_ptr<Packet>> *packets);
+  size_t size() const;
+
+private:
+  mutable std::mutex mutex;
+  std::deque<std::unique_ptr<Packet>> packets;
+  std::atomic<size_t> count;
+};
+
+#endif